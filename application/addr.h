@@ -11,9 +11,9 @@
 #define ADDR_FLASH 0x8000000
 #define ADDR_FLASH_LENGTH  65536
 #define ADDR_APP 0x8010000
-#define ADDR_APP_LENGTH  (190*1024)
-#define ADDR_NVM 0x803F800
-#define ADDR_NVM_LENGTH  (2048)
+#define ADDR_APP_LENGTH  (188*1024)
+#define ADDR_NVM 0x803F000
+#define ADDR_NVM_LENGTH  (4096)
 
 #define ADDR_BL_FLAG_PTR ((volatile uint32_t *)ADDR_BL_FLAG)
 #define ADDR_BL_FLAG_NONE 0
@@ -21,6 +21,4 @@
 #define ADDR_BL_FLAG_SWITCH_EXTD_SESS 456
 #define ADDR_BL_FLAG_SWITCH_GO_TO_APP 789
 
-#define ADDR_NVM_LAST_UNIQ_WORD 0x12345678
-
 #endif // ADDR_H
\ No newline at end of file
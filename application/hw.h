@@ -13,6 +13,8 @@ typedef struct {
 
 void hw_led_green_set(bool on);
 void hw_led_blue_set(bool on);
+bool hw_led_green_get(void);
+bool hw_led_blue_get(void);
 bool hw_read_button(void);
 
 void SystemClock_Config(void);
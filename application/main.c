@@ -3,11 +3,19 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "uds.h"
+#include "uds_ext.h"
+#include "uds_router.h"
 #include "addr.h"
+#include "abs_tim_config.h"
+#include "evt_sched.h"
+#include "uart_log.h"
 #include "uds_config.h"
+#include "nvm.h"
 
 #define UDS_RESP_ID (0x761)
 #define UDS_REQ_ID (0x760)
+//! period of the ISO-TP, UDS and NVM timeouts, requests are served right away on reception
+#define POLL_PERIOD_MS (10)
 
 typedef enum {
 	LED_BLINK_BLUE,
@@ -16,6 +24,27 @@ typedef enum {
 	LED_BLINK_COUNT
 } led_blink_e;
 
+typedef enum {
+	EVT_CAN_RX, // CAN frame is passed to ISO-TP
+	EVT_ISOTP_TX, // ISO-TP has consecutive frames to send
+	EVT_TICK, // HAL tick at which a timer wheel timer is due
+	EVT_COUNT
+} evt_e;
+
+#if defined(USE_LED_BLUE)
+static led_blink_e _led_blink = LED_BLINK_BLUE;
+#elif defined(USE_LED_GREEN)
+static led_blink_e _led_blink = LED_BLINK_GREEN;
+#endif
+static tim_wheel_tim_s _led_tim;
+static bool _led_blue_st; // state chosen by the blink pattern
+static bool _led_green_st;
+static tim_wheel_tim_s _btn_stuck_tim;
+static tim_wheel_tim_s _btn_tim;
+static tim_wheel_tim_s _poll_tim;
+static volatile uint32_t _tick_due_ms; // HAL tick of the earliest timer wheel expiry
+static volatile bool _is_tick_due; // false if no timer is active
+
 ecu_handle_s _ecu_handle = {
 	.tx_header = {
 		.Identifier          = UDS_RESP_ID,
@@ -42,6 +71,8 @@ int  isotp_user_send_can(
 )
 {
 	uint32_t free_elements;
+	// every routed server answers on the response identifier of its own link
+	_ecu_handle.tx_header.Identifier = arbitration_id;
 	_ecu_handle.tx_header.DataLength = size;
 	HAL_FDCAN_AddMessageToTxFifoQ(&_hw.hfdcan1, &_ecu_handle.tx_header, data);
 
@@ -81,162 +112,211 @@ static void can_setup(void)
 	HAL_FDCAN_Start(&_hw.hfdcan1);
 }
 
-static led_blink_e get_led_to_blink(void)
+// if button was pressed for more than 5 seconds, imagine that button was stuck
+static void btn_stuck(void *arg_ptr)
+{
+	(void)arg_ptr;
+	// the DTC itself is raised by the debounce of the DTC store
+	_led_blink = LED_BLINK_COUNT;
+}
+
+// sampled with a fixed period, independent of the client writable blink delay,
+// so the time debounce of the DTC store works with its configured thresholds
+static void btn_sample(void *arg_ptr)
 {
-	static uint64_t btn_timestamp = 0;
 	static bool btn_prev_st = false;
-#if defined(USE_LED_BLUE)
-	static led_blink_e led_blink = LED_BLINK_BLUE;
-#elif defined(USE_LED_GREEN)
-	static led_blink_e led_blink = LED_BLINK_GREEN;
-#endif
 	bool btn_st = hw_read_button();
 
+	(void)arg_ptr;
+
 	if(
 		(btn_st == true) && // button pressed
 		(btn_st != btn_prev_st)) {
-		led_blink++;
-		if(led_blink >= LED_BLINK_COUNT) {
-			led_blink = LED_BLINK_BLUE;
+		_led_blink++;
+		if(_led_blink >= LED_BLINK_COUNT) {
+			_led_blink = LED_BLINK_BLUE;
 		}
 
-		btn_timestamp = abs_tim_get();
-	} else if(
-		(btn_st == true) &&
-		(btn_st == btn_prev_st)
-	) { // still holding the button
-		// if button was pressed for more than 5 seconds, imagine that button was stuck
-		if(abs_tim_get_elapsed(btn_timestamp) > 5000) {
-			// trigger a DTC here
-			led_blink = LED_BLINK_COUNT;
-			uds_set_dtc_st(
-				UDS_CONFIG_DTC_IDX_BUTTON_STUCK,
-				true // set the DTC as triggered
-			);
-		}
+		tim_wheel_start(&_btn_stuck_tim, btn_stuck, NULL, UDS_CONFIG_BTN_STUCK_TIMEOUT_MS, 0);
+	} else if(btn_st == false) {
+		tim_wheel_cancel(&_btn_stuck_tim);
 	}
+	// raw test result, debounced by the DTC store
+	uds_ext_set_dtc_st(UDS_CONFIG_DTC_IDX_BUTTON_STUCK, btn_st);
 
 	btn_prev_st = btn_st;
+}
 
-	return led_blink;
+// a client override from input output control wins over the blink pattern
+static void led_out(void)
+{
+	const uint8_t *blue_ptr = uds_ext_get_io_ctrl(UDS_CONFIG_IO_IDX_LED_BLUE);
+	const uint8_t *green_ptr = uds_ext_get_io_ctrl(UDS_CONFIG_IO_IDX_LED_GREEN);
+
+	hw_led_blue_set((blue_ptr != NULL) ? (blue_ptr[0] != 0u) : _led_blue_st);
+	hw_led_green_set((green_ptr != NULL) ? (green_ptr[0] != 0u) : _led_green_st);
 }
 
-static void led_blink_handler(void)
+static void led_blink(void *arg_ptr)
 {
-	static uint64_t led_timestamp = 0;
 	static bool led_st = true;
-	// blink
-	if(abs_tim_get_elapsed(led_timestamp) >= uds_config_get_blink_delay_ms()) {
-		led_timestamp = abs_tim_get();
-		led_st = !led_st; // toggle led state
-
-		switch(get_led_to_blink()) {
-		case LED_BLINK_BLUE:
-			hw_led_blue_set(led_st);
-			hw_led_green_set(false);
-			break;
-		case LED_BLINK_GREEN:
-			hw_led_blue_set(false);
-			hw_led_green_set(led_st);
-			break;
-		case LED_BLINK_BOTH:
-			// both in same state in same time
-			hw_led_blue_set(led_st);
-			hw_led_green_set(led_st);
-			break;
-		default:
-			// switch between leds
-			hw_led_blue_set(!led_st);
-			hw_led_green_set(led_st);
-			break;
-		}
+
+	(void)arg_ptr;
+	// blink delay can be changed by the client, re-read it for every period
+	tim_wheel_start(&_led_tim, led_blink, NULL, uds_config_get_blink_delay_ms(), 0);
+
+	led_st = !led_st; // toggle led state
+
+	switch(_led_blink) {
+	case LED_BLINK_BLUE:
+		_led_blue_st = led_st;
+		_led_green_st = false;
+		break;
+	case LED_BLINK_GREEN:
+		_led_blue_st = false;
+		_led_green_st = led_st;
+		break;
+	case LED_BLINK_BOTH:
+		// both in same state in same time
+		_led_blue_st = led_st;
+		_led_green_st = led_st;
+		break;
+	default:
+		// switch between leds
+		_led_blue_st = !led_st;
+		_led_green_st = led_st;
+		break;
 	}
+	led_out();
 }
 
-static void nvm_init(void)
+static void update_did_bufs(void)
 {
-	volatile uint32_t *nvm_uniq_ptr = (uint32_t *)(
-		ADDR_RAM_NVM +
-		ADDR_RAM_NVM_LENGTH -
-		4
-	);
+	uint64_t ecu_on_time = abs_tim_get();
+	uds_config_set_ecu_on_time_ms(ecu_on_time);
+}
 
-	(void)memcpy(
-		(void *)ADDR_RAM_NVM,
-		(void *)ADDR_NVM,
-		ADDR_RAM_NVM_LENGTH
-	);
+static bool uds_router_recv(
+	void *link_ptr,
+	uint8_t *data_ptr,
+	uint16_t buf_size,
+	uint16_t *data_size_ptr
+)
+{
+	IsoTpLink *isotp_link_ptr = (IsoTpLink *)link_ptr;
 
-	if((*nvm_uniq_ptr) != ADDR_NVM_LAST_UNIQ_WORD) {
-		(void)memset(
-			(void *)ADDR_RAM_NVM,
-			0,
-			ADDR_RAM_NVM_LENGTH
-		);
-		*nvm_uniq_ptr = ADDR_NVM_LAST_UNIQ_WORD;
-	}
+	isotp_poll(isotp_link_ptr);
+	return isotp_receive(isotp_link_ptr, data_ptr, buf_size, data_size_ptr) == ISOTP_RET_OK;
 }
 
-static void nvm_update(void)
+static uint8_t _uds_router_rx_arr[255] = {0};
+
+// one route per logical ECU, sorted by request identifier.
+// Another server needs its own uds_cfg_s/uds_handle_s with its own callbacks,
+// an ISO-TP link initialized with its response identifier and a CAN filter
+// for its request identifier. The router aborts the extension of a server
+// when the session of that server changes.
+static const uds_router_route_s _uds_route_arr[] = {
+	{
+		.rx_id = UDS_REQ_ID,
+		.link_ptr = &_ecu_handle.isotp_link,
+		.uds_handle_ptr = &_uds_handle,
+		.ext_handle_ptr = &_uds_ext_handle
+	}
+};
+
+static uint8_t _uds_router_diag_sess_arr[sizeof(_uds_route_arr) / sizeof(uds_router_route_s)];
+
+static const uds_router_cfg_s _uds_router_cfg = {
+	.route_arr = _uds_route_arr,
+	.num_route = sizeof(_uds_route_arr) / sizeof(uds_router_route_s),
+	.recv_func_ptr = uds_router_recv,
+	.rx_ptr = _uds_router_rx_arr,
+	.rx_buf_size = sizeof(_uds_router_rx_arr),
+	.diag_sess_arr = _uds_router_diag_sess_arr
+};
+
+static uds_router_handle_s _uds_router;
+
+static void uds_process(void)
 {
-	static FLASH_EraseInitTypeDef flash_erase_init_type = {
-		.TypeErase = FLASH_TYPEERASE_PAGES,
-		.Page = ((uint32_t)ADDR_NVM - ADDR_FLASH) / FLASH_PAGE_SIZE,
-		.NbPages = 1
-	};
-	uint32_t page_err = 0xFFFFFFFFU;
-	bool is_different = false;
-	volatile uint64_t *u64_ptr = NULL;
-
-	is_different = memcmp(
-		(void *)ADDR_RAM_NVM,
-		(void *)ADDR_NVM,
-		ADDR_RAM_NVM_LENGTH
-	) == 0 ? false : true;
-
-	if(is_different) {
-		HAL_FLASH_Unlock();
-		__HAL_FLASH_CLEAR_FLAG(
-			FLASH_FLAG_EOP |
-			FLASH_FLAG_PGAERR |
-			FLASH_FLAG_WRPERR |
-			FLASH_FLAG_OPTVERR
-		);
-		HAL_FLASHEx_Erase(&flash_erase_init_type, &page_err);
-		u64_ptr = (uint64_t *)ADDR_RAM_NVM;
-		for(int i = 0; i < (ADDR_RAM_NVM_LENGTH/sizeof(uint64_t)); ++i) {
-			HAL_FLASH_Program(
-				FLASH_TYPEPROGRAM_DOUBLEWORD,
-				ADDR_NVM + (sizeof(uint64_t) * i),
-				*u64_ptr
-			);
-			u64_ptr++;
+	uds_router_x_process(&_uds_router);
+
+	for(uint8_t i = 0; i < _uds_router_cfg.num_route; ++i) {
+		const IsoTpLink *isotp_link_ptr = (const IsoTpLink *)_uds_route_arr[i].link_ptr;
+
+		if(isotp_link_ptr->send_status == ISOTP_SEND_STATUS_INPROGRESS) {
+			evt_sched_post(EVT_ISOTP_TX);
+			break;
 		}
-		HAL_FLASH_Lock();
 	}
 }
 
-static void update_did_bufs(void)
+// timeouts of ISO-TP, the UDS core and extension and the NVM commit
+static void poll_process(void *arg_ptr)
 {
-	uint64_t ecu_on_time = abs_tim_get();
-	uds_config_set_ecu_on_time_ms(ecu_on_time);
+	(void)arg_ptr;
+	update_did_bufs();
+	nvm_update();
+	uds_process();
+	// overrides take effect and are released without waiting for the next blink
+	led_out();
 }
 
-int main(void)
+static void tick_process(void)
 {
-	uint8_t payload_arr[255] = {0};
-	uint16_t out_size = 0;
+	tim_wheel_handler();
+}
 
-	int ret;
+static void sched_idle(void)
+{
+	uint32_t remaining_ms = 0;
+
+	__disable_irq();
+	if(!evt_sched_is_pending()) {
+		// the tick wakes the scheduler only when the next timer is due
+		_is_tick_due = tim_wheel_get_next_expiry(&remaining_ms);
+		_tick_due_ms = HAL_GetTick() + remaining_ms;
+		__WFI(); // wakes up on a pending interrupt even with interrupts disabled
+	}
+	__enable_irq();
+}
+
+static const evt_sched_handler_t _evt_handler_arr[EVT_COUNT] = {
+	[EVT_CAN_RX] = uds_process,
+	[EVT_ISOTP_TX] = uds_process,
+	[EVT_TICK] = tick_process
+};
 
+evt_sched_cfg_s _evt_sched_cfg = {
+	.handler_ptr = _evt_handler_arr,
+	.num_evt = EVT_COUNT,
+	.idle_func_ptr = sched_idle
+};
+
+evt_sched_handle_s _evt_sched;
+
+void HAL_IncTick(void)
+{
+	uwTick += (uint32_t)uwTickFreq;
+	if(_is_tick_due && ((int32_t)(uwTick - _tick_due_ms) >= 0)) {
+		evt_sched_post(EVT_TICK);
+	}
+}
+
+int main(void)
+{
 	HAL_Init();
 	SystemClock_Config();
 	MX_GPIO_Init();
 	MX_USART1_UART_Init();
+	uart_log_init();
 	MX_FDCAN1_Init();
 	MX_TIM14_Init();
 
-	HAL_TIM_Base_Start(&_hw.htim14);
+	// update interrupt counts the overflows of the 16-bit timer
+	__HAL_TIM_CLEAR_FLAG(&_hw.htim14, TIM_FLAG_UPDATE);
+	HAL_TIM_Base_Start_IT(&_hw.htim14);
 
 	nvm_init();
 	can_setup();
@@ -249,6 +329,8 @@ int main(void)
 		sizeof(_ecu_handle.isotp_rx_arr)
 	);
 	abs_tim_init();
+	tim_wheel_init();
+	evt_sched_init();
 
 	if(*ADDR_BL_FLAG_PTR == ADDR_BL_FLAG_SWITCH_EXTD_SESS) {
 		*ADDR_BL_FLAG_PTR = ADDR_BL_FLAG_NONE;
@@ -257,53 +339,45 @@ int main(void)
 	}
 
 	uds_init();
+	uds_ext_init();
+	uds_router_x_init(&_uds_router, &_uds_router_cfg);
 
-	printf("Application started\n");
+	UART_LOG_INF("Application started\n");
+	tim_wheel_start(&_led_tim, led_blink, NULL, 0, 0);
+	tim_wheel_start(&_btn_tim, btn_sample, NULL, 0, UDS_CONFIG_BTN_SAMPLE_PERIOD_MS);
+	tim_wheel_start(&_poll_tim, poll_process, NULL, 0, POLL_PERIOD_MS);
 	__enable_irq();
 
-	while(1) {
-		nvm_update();
-
-		isotp_poll(&_ecu_handle.isotp_link);
-		ret = isotp_receive(
-			&_ecu_handle.isotp_link,
-			payload_arr,
-			sizeof(payload_arr),
-			&out_size
-		);
-		if(ret == ISOTP_RET_OK) {
-			uds_put_packet_in(payload_arr, out_size);
-		}
-		uds_handler();
-
-		led_blink_handler();
-
-		update_did_bufs();
-	}
+	evt_sched_run();
 	return 0;
 }
 
 void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
 {
+	const uds_router_route_s *route_ptr;
+
 	if((RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) == 0U) {
 		return;
 	}
 	if(HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO0, &_ecu_handle.rx_header, _ecu_handle.rx_data_arr) != HAL_OK) {
 		//Error_Handler();
-	} else if(
-		(_ecu_handle.rx_header.Identifier == UDS_REQ_ID) &&
-		(_ecu_handle.rx_header.IdType     == FDCAN_STANDARD_ID)
+		return;
+	}
+	route_ptr = uds_router_x_find(&_uds_router, _ecu_handle.rx_header.Identifier);
+	if(
+		(route_ptr != NULL) &&
+		(_ecu_handle.rx_header.IdType == FDCAN_STANDARD_ID)
 	) {
 		isotp_on_can_message(
-			&_ecu_handle.isotp_link,
+			(IsoTpLink *)route_ptr->link_ptr,
 			_ecu_handle.rx_data_arr,
 			_ecu_handle.rx_header.DataLength
 		);
+		evt_sched_post(EVT_CAN_RX);
 	}
 }
 
 int __io_putchar(int ch)
 {
-	HAL_UART_Transmit(&_hw.huart1, (uint8_t *)&ch, 1, HAL_MAX_DELAY);
-	return ch;
+	return uart_log_putchar(ch);
 }
@@ -0,0 +1,415 @@
+#include "nvm.h"
+#include "hw.h"
+#include "addr.h"
+#include "uart_log.h"
+#include "abs_tim_config.h"
+#include <string.h>
+#include <assert.h>
+#include <stddef.h>
+
+#define NVM_PAGE_SIZE (FLASH_PAGE_SIZE)
+#define NVM_NUM_PAGE (ADDR_NVM_LENGTH / NVM_PAGE_SIZE)
+#define NVM_CHUNK_SIZE 8u // one flash doubleword
+#define NVM_NUM_CHUNK (ADDR_RAM_NVM_LENGTH / NVM_CHUNK_SIZE)
+#define NVM_HDR_SIZE 16u
+#define NVM_REC_SIZE 16u
+#define NVM_NUM_SLOT ((NVM_PAGE_SIZE - NVM_HDR_SIZE) / NVM_REC_SIZE)
+#define NVM_PAGE_MAGIC ((uint32_t)0x314D564E) // "NVM1"
+
+#if NVM_NUM_PAGE != 2
+#error "ADDR_NVM_LENGTH has to hold two flash pages"
+#endif
+
+#if ((ADDR_RAM_NVM_LENGTH % NVM_CHUNK_SIZE) != 0) || (NVM_NUM_CHUNK > 32)
+#error "ADDR_RAM_NVM_LENGTH has to be at most 32 doublewords"
+#endif
+
+#define NVM_REC_FLAG_LAST 0x01u //!< last record of a commit, the commit is valid only with it
+
+typedef struct {
+	uint32_t magic;
+	uint32_t seq; //!< incremented on every compaction, the highest valid one is active
+	uint16_t crc; //!< over magic and seq
+	uint16_t reserved0;
+	uint32_t reserved1;
+} nvm_page_hdr_s;
+
+typedef struct {
+	uint8_t data_arr[NVM_CHUNK_SIZE];
+	// second doubleword, programmed after data
+	uint8_t key; //!< chunk index
+	uint8_t flags;
+	uint16_t crc; //!< over data, key, flags and seq
+	uint32_t seq; //!< commit sequence number, same for all records of a commit
+} nvm_rec_s;
+
+static uint32_t _nvm_page_idx = 0;
+static uint32_t _nvm_page_seq = 0;
+static uint32_t _nvm_commit_seq = 0;
+static uint32_t _nvm_free_slot = NVM_NUM_SLOT; // full until a valid page is found
+//! address of the newest flash copy of each chunk, 0 if it has none
+static uint32_t _nvm_chunk_addr_arr[NVM_NUM_CHUNK];
+//! chunks written since the last flush, bit per chunk
+static uint32_t _nvm_dirty_mask = 0;
+//! incremented on every nvm_mark_dirty, nothing to do while it equals _nvm_flushed_gen
+static uint32_t _nvm_gen = 0;
+static uint32_t _nvm_flushed_gen = 0;
+static uint32_t _nvm_first_dirty_ms = 0;
+static uint32_t _nvm_last_dirty_ms = 0;
+static uint32_t _nvm_last_commit_ms = 0;
+static bool _nvm_is_held = false;
+
+static uint32_t nvm_page_addr(uint32_t page_idx)
+{
+	return ADDR_NVM + (page_idx * NVM_PAGE_SIZE);
+}
+
+static const nvm_rec_s *nvm_get_rec(uint32_t page_idx, uint32_t slot)
+{
+	return (const nvm_rec_s *)(nvm_page_addr(page_idx) + NVM_HDR_SIZE + (slot * NVM_REC_SIZE));
+}
+
+static bool nvm_is_erased(const void *ptr, uint32_t size)
+{
+	const uint8_t *u8_ptr = (const uint8_t *)ptr;
+
+	for(uint32_t i = 0; i < size; ++i) {
+		if(u8_ptr[i] != 0xFF) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//! CRC-16/CCITT-FALSE
+static uint16_t nvm_crc16(uint16_t crc, const void *data_ptr, uint32_t size)
+{
+	const uint8_t *u8_ptr = (const uint8_t *)data_ptr;
+
+	for(uint32_t i = 0; i < size; ++i) {
+		crc ^= (uint16_t)u8_ptr[i] << 8;
+		for(uint8_t bit = 0; bit < 8; ++bit) {
+			crc = ((crc & 0x8000u) != 0) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+static uint16_t nvm_calc_hdr_crc(const nvm_page_hdr_s *hdr_ptr)
+{
+	return nvm_crc16(0xFFFFu, hdr_ptr, offsetof(nvm_page_hdr_s, crc));
+}
+
+static uint16_t nvm_calc_rec_crc(const nvm_rec_s *rec_ptr)
+{
+	uint16_t crc = nvm_crc16(0xFFFFu, rec_ptr, offsetof(nvm_rec_s, crc));
+	return nvm_crc16(crc, &rec_ptr->seq, sizeof(rec_ptr->seq));
+}
+
+static bool nvm_is_hdr_valid(const nvm_page_hdr_s *hdr_ptr)
+{
+	return (hdr_ptr->magic == NVM_PAGE_MAGIC) && (hdr_ptr->crc == nvm_calc_hdr_crc(hdr_ptr));
+}
+
+static bool nvm_is_rec_valid(const nvm_rec_s *rec_ptr)
+{
+	return (rec_ptr->crc == nvm_calc_rec_crc(rec_ptr)) && (rec_ptr->key < NVM_NUM_CHUNK);
+}
+
+static uint8_t *nvm_get_chunk(uint32_t chunk_idx)
+{
+	return (uint8_t *)ADDR_RAM_NVM + (chunk_idx * NVM_CHUNK_SIZE);
+}
+
+static bool nvm_program(uint32_t addr, const void *data_ptr, uint32_t size)
+{
+	uint64_t dword;
+
+	for(uint32_t i = 0; i < size; i += sizeof(uint64_t)) {
+		(void)memcpy(&dword, (const uint8_t *)data_ptr + i, sizeof(uint64_t));
+		if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr + i, dword) != HAL_OK) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool nvm_erase_page(uint32_t page_idx)
+{
+	FLASH_EraseInitTypeDef flash_erase_init_type = {
+		.TypeErase = FLASH_TYPEERASE_PAGES,
+		.Page = (nvm_page_addr(page_idx) - ADDR_FLASH) / FLASH_PAGE_SIZE,
+		.NbPages = 1
+	};
+	uint32_t page_err = 0xFFFFFFFFU;
+
+	if(HAL_FLASHEx_Erase(&flash_erase_init_type, &page_err) != HAL_OK) {
+		return false;
+	}
+	return page_err == 0xFFFFFFFFU;
+}
+
+//! Programs a chunk record, data first, the second doubleword commits the record
+static bool nvm_program_rec(uint32_t rec_addr, uint32_t chunk_idx, uint32_t seq, bool is_last)
+{
+	nvm_rec_s rec;
+
+	(void)memcpy(rec.data_arr, nvm_get_chunk(chunk_idx), NVM_CHUNK_SIZE);
+	rec.key = (uint8_t)chunk_idx;
+	rec.flags = is_last ? NVM_REC_FLAG_LAST : 0;
+	rec.seq = seq;
+	rec.crc = nvm_calc_rec_crc(&rec);
+
+	if(!nvm_program(rec_addr, rec.data_arr, NVM_CHUNK_SIZE)) {
+		return false;
+	}
+	return nvm_program(rec_addr + NVM_CHUNK_SIZE, &rec.key, NVM_REC_SIZE - NVM_CHUNK_SIZE);
+}
+
+/**
+ * Writes the chunks of a mask as one commit starting from a slot.
+ * The chunk copies move to the new records only when the whole commit is in flash.
+ */
+static bool nvm_program_commit(uint32_t page_idx, uint32_t slot, uint32_t chunk_mask)
+{
+	uint32_t rec_addr_arr[NVM_NUM_CHUNK];
+	uint32_t seq = ++_nvm_commit_seq; // never reused, even if this commit fails
+	bool is_ok = true;
+
+	for(uint32_t i = 0; (i < NVM_NUM_CHUNK) && is_ok; ++i) {
+		if((chunk_mask & (1UL << i)) == 0) {
+			continue;
+		}
+		rec_addr_arr[i] = (uint32_t)nvm_get_rec(page_idx, slot);
+		slot++;
+		if(page_idx == _nvm_page_idx) {
+			// the slot is used even if programming fails, it is not erased anymore
+			_nvm_free_slot = slot;
+		}
+		is_ok = nvm_program_rec(
+			rec_addr_arr[i],
+			i,
+			seq,
+			(chunk_mask & ~((2UL << i) - 1UL)) == 0 // no higher chunk left
+		);
+	}
+
+	if(!is_ok) {
+		return false;
+	}
+	for(uint32_t i = 0; i < NVM_NUM_CHUNK; ++i) {
+		if((chunk_mask & (1UL << i)) != 0) {
+			_nvm_chunk_addr_arr[i] = rec_addr_arr[i];
+		}
+	}
+	return true;
+}
+
+/**
+ * Writes the whole mirror into the other page and activates it with its header.
+ * The old page stays valid until the next compaction erases it.
+ */
+static bool nvm_compact(void)
+{
+	uint32_t page_idx = (_nvm_page_idx + 1) % NVM_NUM_PAGE;
+	uint32_t all_mask = (NVM_NUM_CHUNK == 32) ? 0xFFFFFFFFUL : ((1UL << NVM_NUM_CHUNK) - 1);
+	nvm_page_hdr_s hdr = {
+		.magic = NVM_PAGE_MAGIC,
+		.seq = _nvm_page_seq + 1,
+		.reserved0 = 0xFFFFu,
+		.reserved1 = 0xFFFFFFFFU
+	};
+
+	hdr.crc = nvm_calc_hdr_crc(&hdr);
+
+	if(
+		!nvm_erase_page(page_idx) ||
+		!nvm_program_commit(page_idx, 0, all_mask) ||
+		!nvm_program(nvm_page_addr(page_idx), &hdr, sizeof(hdr))
+	) {
+		// the old page is still the active one, every chunk is written again on the next update
+		(void)memset(_nvm_chunk_addr_arr, 0, sizeof(_nvm_chunk_addr_arr));
+		return false;
+	}
+
+	_nvm_page_idx = page_idx;
+	_nvm_page_seq = hdr.seq;
+	_nvm_free_slot = NVM_NUM_CHUNK;
+	return true;
+}
+
+/**
+ * Replays the commits of a page in order.
+ * Records are applied only when the last record of their commit is found,
+ * a commit cut by a power loss is dropped as a whole.
+ */
+static void nvm_load_page(uint32_t page_idx)
+{
+	const nvm_rec_s *rec_ptr;
+	uint32_t commit_first_slot = 0;
+	bool is_commit_open = false;
+
+	_nvm_page_idx = page_idx;
+	_nvm_page_seq = ((const nvm_page_hdr_s *)nvm_page_addr(page_idx))->seq;
+	_nvm_free_slot = NVM_NUM_SLOT;
+
+	for(uint32_t slot = 0; slot < NVM_NUM_SLOT; ++slot) {
+		rec_ptr = nvm_get_rec(page_idx, slot);
+		if(nvm_is_erased(rec_ptr, NVM_REC_SIZE)) {
+			_nvm_free_slot = slot; // end of the log
+			break;
+		}
+		if(!nvm_is_rec_valid(rec_ptr)) {
+			is_commit_open = false; // torn record of a power loss
+			continue;
+		}
+
+		if(!is_commit_open || (rec_ptr->seq != _nvm_commit_seq)) {
+			commit_first_slot = slot;
+			is_commit_open = true;
+		}
+		// the next commit has to use a new number even if this one is dropped
+		_nvm_commit_seq = rec_ptr->seq;
+
+		if((rec_ptr->flags & NVM_REC_FLAG_LAST) == 0) {
+			continue;
+		}
+		for(uint32_t i = commit_first_slot; i <= slot; ++i) {
+			rec_ptr = nvm_get_rec(page_idx, i);
+			if(nvm_is_rec_valid(rec_ptr) && (rec_ptr->seq == _nvm_commit_seq)) {
+				(void)memcpy(nvm_get_chunk(rec_ptr->key), rec_ptr->data_arr, NVM_CHUNK_SIZE);
+				_nvm_chunk_addr_arr[rec_ptr->key] = (uint32_t)rec_ptr;
+			}
+		}
+		is_commit_open = false;
+	}
+}
+
+static void nvm_commit(void)
+{
+	uint32_t changed_mask = 0;
+	uint32_t num_changed = 0;
+	bool is_ok;
+
+	// only dirty chunks are compared, writing the same value again is not a change
+	for(uint32_t i = 0; i < NVM_NUM_CHUNK; ++i) {
+		if(
+			((_nvm_dirty_mask & (1UL << i)) != 0) &&
+			(
+				(_nvm_chunk_addr_arr[i] == 0) ||
+				(memcmp(nvm_get_chunk(i), (const void *)_nvm_chunk_addr_arr[i], NVM_CHUNK_SIZE) != 0)
+			)
+		) {
+			changed_mask |= (1UL << i);
+			num_changed++;
+		}
+	}
+	_nvm_dirty_mask = 0;
+	_nvm_flushed_gen = _nvm_gen;
+	_nvm_last_commit_ms = abs_tim_get_ms32();
+
+	if(num_changed == 0) {
+		return;
+	}
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(
+		FLASH_FLAG_EOP |
+		FLASH_FLAG_PGAERR |
+		FLASH_FLAG_WRPERR |
+		FLASH_FLAG_OPTVERR
+	);
+	if(num_changed > (NVM_NUM_SLOT - _nvm_free_slot)) {
+		is_ok = nvm_compact();
+	} else {
+		is_ok = nvm_program_commit(_nvm_page_idx, _nvm_free_slot, changed_mask);
+	}
+	HAL_FLASH_Lock();
+
+	if(!is_ok) {
+		nvm_mark_dirty(0, ADDR_RAM_NVM_LENGTH); // retried on the next update
+		UART_LOG_ERR("Error: NVM write failed\n");
+	}
+}
+
+static bool nvm_is_commit_due(void)
+{
+	if(abs_tim_get_elapsed_ms32(_nvm_last_commit_ms) < NVM_COMMIT_MIN_INTERVAL_MS) {
+		return false;
+	}
+	// a burst of writes is coalesced until it settles or gets too old
+	return (
+		(abs_tim_get_elapsed_ms32(_nvm_last_dirty_ms) >= NVM_COMMIT_MIN_INTERVAL_MS) ||
+		(abs_tim_get_elapsed_ms32(_nvm_first_dirty_ms) >= NVM_COMMIT_MAX_LATENCY_MS)
+	);
+}
+
+void nvm_init(void)
+{
+	const nvm_page_hdr_s *hdr_ptr;
+	int32_t active_page_idx = -1;
+	uint32_t active_seq = 0;
+
+	for(uint32_t i = 0; i < NVM_NUM_PAGE; ++i) {
+		hdr_ptr = (const nvm_page_hdr_s *)nvm_page_addr(i);
+		if(
+			nvm_is_hdr_valid(hdr_ptr) &&
+			((active_page_idx < 0) || ((int32_t)(hdr_ptr->seq - active_seq) > 0))
+		) {
+			active_page_idx = (int32_t)i;
+			active_seq = hdr_ptr->seq;
+		}
+	}
+
+	(void)memset((void *)ADDR_RAM_NVM, 0, ADDR_RAM_NVM_LENGTH);
+	(void)memset(_nvm_chunk_addr_arr, 0, sizeof(_nvm_chunk_addr_arr));
+	_nvm_dirty_mask = 0;
+	_nvm_flushed_gen = _nvm_gen;
+	_nvm_last_commit_ms = abs_tim_get_ms32();
+	if(active_page_idx >= 0) {
+		nvm_load_page((uint32_t)active_page_idx);
+	} else {
+		nvm_mark_dirty(0, ADDR_RAM_NVM_LENGTH); // nothing in flash yet, all zero
+	}
+}
+
+void nvm_mark_dirty(uint32_t addr, uint32_t size)
+{
+	uint32_t first_chunk;
+	uint32_t last_chunk;
+
+	assert(size > 0);
+	assert((addr + size) <= ADDR_RAM_NVM_LENGTH);
+
+	_nvm_last_dirty_ms = abs_tim_get_ms32();
+	if(_nvm_gen == _nvm_flushed_gen) {
+		_nvm_first_dirty_ms = _nvm_last_dirty_ms;
+	}
+
+	first_chunk = addr / NVM_CHUNK_SIZE;
+	last_chunk = (addr + size - 1) / NVM_CHUNK_SIZE;
+	for(uint32_t i = first_chunk; i <= last_chunk; ++i) {
+		_nvm_dirty_mask |= (1UL << i);
+	}
+	_nvm_gen++;
+}
+
+void nvm_update(void)
+{
+	if(_nvm_is_held || (_nvm_gen == _nvm_flushed_gen) || !nvm_is_commit_due()) {
+		return;
+	}
+	nvm_commit();
+}
+
+void nvm_flush(void)
+{
+	if(_nvm_gen != _nvm_flushed_gen) {
+		nvm_commit();
+	}
+}
+
+void nvm_hold(bool is_held)
+{
+	_nvm_is_held = is_held;
+}
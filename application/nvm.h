@@ -0,0 +1,53 @@
+#ifndef NVM_H
+#define NVM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Log structured NVM behind the ADDR_RAM_NVM mirror.
+ * The mirror is split into doubleword chunks. A changed chunk is appended as a record
+ * to the active flash page instead of erasing and rewriting the whole page.
+ * When the active page is full, the current mirror is compacted into the other page
+ * and that one becomes active, so a page is erased only once per page worth of records.
+ *
+ * Page layout: header (magic, page sequence number, CRC) followed by 16 byte records
+ * (chunk data, chunk key, commit sequence number, CRC). The chunks changed together
+ * are written as one commit, the last record of a commit is flagged. Data is programmed
+ * before the rest of a record, the last record after the others and the header of a new
+ * page after all its records, so a power loss never leaves a half written commit
+ * or page visible.
+ *
+ * Writes are coalesced: a commit is started once the mirror has not been written for
+ * NVM_COMMIT_MIN_INTERVAL_MS, or NVM_COMMIT_MAX_LATENCY_MS after the first pending write,
+ * but never sooner than NVM_COMMIT_MIN_INTERVAL_MS after the previous commit.
+ * nvm_flush commits at once, e.g. before a reset.
+ */
+
+#ifndef NVM_COMMIT_MIN_INTERVAL_MS
+#define NVM_COMMIT_MIN_INTERVAL_MS 1000u
+#endif
+
+#ifndef NVM_COMMIT_MAX_LATENCY_MS
+//! Not less than NVM_COMMIT_MIN_INTERVAL_MS
+#define NVM_COMMIT_MAX_LATENCY_MS 5000u
+#endif
+
+//! Loads the mirror from the newest valid page
+void nvm_init(void);
+/**
+ * Marks a byte range of the mirror as written, to be called after every write into it.
+ * nvm_update only looks at the marked chunks.
+ */
+void nvm_mark_dirty(uint32_t addr, uint32_t size);
+//! Commits the changed chunks of the mirror when the commit policy allows it, call periodically
+void nvm_update(void);
+//! Commits the changed chunks of the mirror at once
+void nvm_flush(void);
+/**
+ * Holds back the commits of nvm_update, e.g. while DTC setting is off during programming.
+ * Writes keep collecting in the mirror, nvm_flush still commits at once.
+ */
+void nvm_hold(bool is_held);
+
+#endif // NVM_H
@@ -0,0 +1,59 @@
+#ifndef UART_LOG_H
+#define UART_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Non-blocking logger. printf output is queued into a ring buffer by __io_putchar
+ * and sent by the USART1 transmit interrupt. If the ring is full, characters are dropped
+ * and counted instead of stalling the caller.
+ *
+ * Log macros below UART_LOG_LEVEL are removed at compile time,
+ * so hot path logs (UART_LOG_DBG) cost nothing in normal builds.
+ */
+
+#define UART_LOG_LEVEL_NONE 0
+#define UART_LOG_LEVEL_ERR 1
+#define UART_LOG_LEVEL_INF 2
+#define UART_LOG_LEVEL_DBG 3
+
+#ifndef UART_LOG_LEVEL
+#define UART_LOG_LEVEL UART_LOG_LEVEL_INF
+#endif
+
+#ifndef UART_LOG_BUF_SIZE
+//! Size of the ring buffer, power of two
+#define UART_LOG_BUF_SIZE 512u
+#endif
+
+#if UART_LOG_LEVEL >= UART_LOG_LEVEL_ERR
+#define UART_LOG_ERR(...) printf(__VA_ARGS__)
+#else
+#define UART_LOG_ERR(...) ((void)0)
+#endif
+
+#if UART_LOG_LEVEL >= UART_LOG_LEVEL_INF
+#define UART_LOG_INF(...) printf(__VA_ARGS__)
+#else
+#define UART_LOG_INF(...) ((void)0)
+#endif
+
+#if UART_LOG_LEVEL >= UART_LOG_LEVEL_DBG
+#define UART_LOG_DBG(...) printf(__VA_ARGS__)
+#else
+#define UART_LOG_DBG(...) ((void)0)
+#endif
+
+//! Enables the USART1 interrupt, call after MX_USART1_UART_Init
+void uart_log_init(void);
+//! Queue a character, never blocks
+int uart_log_putchar(int ch);
+//! Send everything queued, blocking. Use before reset or jumping to another image.
+void uart_log_flush(void);
+//! Number of characters dropped because the ring buffer was full
+uint32_t uart_log_get_drop_count(void);
+//! To be called from USART1_IRQHandler
+void uart_log_irq(void);
+
+#endif // UART_LOG_H
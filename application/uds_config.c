@@ -1,14 +1,23 @@
 #include "uds.h"
+#include "uds_ext.h"
 #include "main.h"
 #include "abs_tim.h"
 #include "stm32c0xx_hal.h"
 #include <stdio.h>
+#include "uart_log.h"
 #include <assert.h>
 #include "addr.h"
 #include "uds_config.h"
+#include "nvm.h"
+#include "hw.h"
 
 #define UDS_PACKET_RX_BUF_LEN 255
 #define UDS_PACKET_TX_BUF_LEN 32
+//! NVM address of the DTC records of the extension DTC store
+#define UDS_CONFIG_NVM_ADDR_EXT_DTC 0
+//! NVM address of the snapshot ring, after the DTC records
+#define UDS_CONFIG_NVM_ADDR_EXT_SNAP (UDS_CONFIG_NVM_ADDR_EXT_DTC + (UDS_CONFIG_DTC_IDX_COUNT * UDS_EXT_DTC_NVM_REC_SIZE))
+#define UDS_CONFIG_NUM_EXT_SNAP 4
 
 //! Security subfunction id for seed req for calibration
 //! This subfunction id also re-presents security level
@@ -28,7 +37,9 @@ uint32_t _bl_flag __attribute__((section(".bl_flag_s")));
 
 static void uds_diag_sess_on_changed(uint8_t new_sess)
 {
-	printf("sess:%d\n", (int)new_sess);
+	UART_LOG_INF("sess:%d\n", (int)new_sess);
+	nvm_flush();
+	// the extension is aborted by the router, see uds_router.h
 	if(new_sess == UDS_DIAG_SESS_PROG) {
 		*ADDR_BL_FLAG_PTR = ADDR_BL_FLAG_SWITCH_PROG_SESS;
 		HAL_NVIC_SystemReset();
@@ -40,16 +51,32 @@ static void uds_diag_sess_on_changed(uint8_t new_sess)
 
 static void uds_ecu_reset(uint8_t reset_type)
 {
-	printf("reset:%d\n", (int)reset_type);
+	UART_LOG_INF("reset:%d\n", (int)reset_type);
+	uds_ext_end_dtc_op_cycle();
+	nvm_flush();
+	uart_log_flush();
 	HAL_NVIC_SystemReset();
 	while (1) {
 		__asm__("nop");
 	}
 }
 
+static void uds_dtc_setting_on_changed(bool is_on)
+{
+	UART_LOG_INF("dtc setting:%d\n", (int)is_on);
+	// keep flash free for the programming traffic until the setting is back on
+	nvm_hold(!is_on);
+}
+
+static void uds_comm_ctrl_on_changed(uint8_t rx_en_mask, uint8_t tx_en_mask)
+{
+	// the application has no periodic messages yet, uds_ext_is_comm_tx_en gates them once added
+	UART_LOG_INF("comm rx:%d tx:%d\n", (int)rx_en_mask, (int)tx_en_mask);
+}
+
 static void uds_security_level_on_changed(uint8_t new_level)
 {
-	printf("level:%d\n", (int)new_level);
+	UART_LOG_INF("level:%d\n", (int)new_level);
 	return;
 }
 
@@ -210,42 +237,22 @@ static uds_config_did_arr_wrapper_s _did_arr_wrap = {
 	}
 };
 
-typedef struct {
-	uds_dtc_s dtc_arr[UDS_CONFIG_DTC_IDX_COUNT];
-} uds_config_dtc_arr_wrapper_s;
-
-uint16_t _dtc_button_stuck_did_idx_arr[] = {
-	UDS_CONFIG_DID_IDX_ON_TIME
-};
-
-static uds_config_dtc_arr_wrapper_s _dtc_arr_wrap = {
-	.dtc_arr[UDS_CONFIG_DTC_IDX_BUTTON_STUCK] = {
-		.status.r = 0,
-		.id = {
-			.high = 0x81,
-			.mid = 0x23,
-			.low = 0x9e
-		},
-		.snap_did_idx_ptr = _dtc_button_stuck_did_idx_arr,
-		.num_of_snaps = sizeof(_dtc_button_stuck_did_idx_arr) / sizeof(uint16_t)
-	}
-};
-
 static void nvm_write(uint32_t addr, const uint8_t *data_ptr, uint16_t data_size)
 {
 	assert(data_ptr != NULL);
 	assert(data_size > 0);
-	assert(addr < ADDR_RAM_NVM_LENGTH);
+	assert((addr + data_size) <= ADDR_RAM_NVM_LENGTH);
 
 	uint8_t *nvm_arr = ((uint8_t *)ADDR_RAM_NVM);
 	memcpy(&nvm_arr[addr], data_ptr, data_size);
+	nvm_mark_dirty(addr, data_size);
 }
 
 static void nvm_read(uint32_t addr, uint8_t *data_ptr, uint16_t data_size)
 {
 	assert(data_ptr != NULL);
 	assert(data_size > 0);
-	assert(addr < ADDR_RAM_NVM_LENGTH);
+	assert((addr + data_size) <= ADDR_RAM_NVM_LENGTH);
 
 	uint8_t *nvm_arr = ((uint8_t *)ADDR_RAM_NVM);
 	memcpy(data_ptr, &nvm_arr[addr], data_size);
@@ -263,8 +270,8 @@ uds_cfg_s _uds_cfg = {
 		.req_transfer_exit= false,
 		.transfer_data= false,
 		.read_data_by_id= true,
-		.read_dtc_info= true,
-		.clear_dtc_info = true
+		.read_dtc_info= false, // served by the extension DTC store
+		.clear_dtc_info = false
 	},
 
 	// it should be able to hold single uds packet.
@@ -308,14 +315,127 @@ uds_cfg_s _uds_cfg = {
 	.startup_security_level = 0,
 
 	.generate_pos_resp_prog = false,
-	.generate_pos_resp_extd = false,
+	.generate_pos_resp_extd = false
+};
+
+uds_handle_s _uds_handle;
+
+static uint8_t _uds_ext_tx_packet_arr[ISOTP_BUFSIZE] = {0};
+
+//! sorted ascending, indexed by uds_config_dtc_idx_e
+static const uint32_t _ext_dtc_id_arr[UDS_CONFIG_DTC_IDX_COUNT] = {
+	[UDS_CONFIG_DTC_IDX_BUTTON_STUCK] = 0x81239E
+};
+static const uds_ext_dtc_deb_cfg_s _ext_dtc_deb_cfg_arr[UDS_CONFIG_DTC_IDX_COUNT] = {
+	[UDS_CONFIG_DTC_IDX_BUTTON_STUCK] = {
+		.type = UDS_EXT_DTC_DEB_TIME,
+		.fail_thr = UDS_CONFIG_BTN_STUCK_TIMEOUT_MS,
+		.pass_thr = 50, // contact bounce, a few UDS_CONFIG_BTN_SAMPLE_PERIOD_MS
+		.confirm_thr = 1,
+		.aging_thr = 3
+	}
+};
+static uds_ext_dtc_deb_s _ext_dtc_deb_arr[UDS_CONFIG_DTC_IDX_COUNT];
+static const uint16_t _dtc_button_stuck_did_idx_arr[] = {
+	UDS_CONFIG_DID_IDX_ON_TIME
+};
+static const uds_ext_dtc_snap_cfg_s _ext_dtc_snap_cfg_arr[UDS_CONFIG_DTC_IDX_COUNT] = {
+	[UDS_CONFIG_DTC_IDX_BUTTON_STUCK] = {
+		.did_idx_arr = _dtc_button_stuck_did_idx_arr,
+		.num_did = sizeof(_dtc_button_stuck_did_idx_arr) / sizeof(uint16_t)
+	}
+};
+static uds_ext_dtc_snap_s _ext_dtc_snap_arr[UDS_CONFIG_NUM_EXT_SNAP];
+static uint8_t _ext_dtc_st_arr[UDS_CONFIG_DTC_IDX_COUNT];
+static uint32_t _ext_dtc_st_bit_arr[UDS_EXT_DTC_ST_BIT_ARR_SIZE(UDS_CONFIG_DTC_IDX_COUNT)];
+
+static void io_led_blue_get(uint8_t *data_ptr)
+{
+	data_ptr[0] = hw_led_blue_get() ? 1u : 0u;
+}
+
+static void io_led_green_get(uint8_t *data_ptr)
+{
+	data_ptr[0] = hw_led_green_get() ? 1u : 0u;
+}
+
+static const uds_ext_io_ctrl_sig_s _ext_io_sig_arr[UDS_CONFIG_IO_IDX_COUNT] = {
+	[UDS_CONFIG_IO_IDX_LED_BLUE] = {
+		.did = 0x2028,
+		.size = 1, // 0 off, otherwise on
+		.timeout_ms = 0, // held until the session ends, S3 timeout included
+		.get_func_ptr = io_led_blue_get
+	},
+	[UDS_CONFIG_IO_IDX_LED_GREEN] = {
+		.did = 0x2029,
+		.size = 1,
+		.timeout_ms = 0,
+		.get_func_ptr = io_led_green_get
+	}
+};
+static uds_ext_io_ctrl_st_s _ext_io_st_arr[UDS_CONFIG_IO_IDX_COUNT];
+
+const uds_ext_cfg_s _uds_ext_cfg = {
+	.is_serv_en = {
+		.dtc = true,
+		.ctrl_dtc_setting = true,
+		.comm_ctrl = true,
+		.io_ctrl = true
+	},
+
+	// it should be able to hold the longest DTC list
+	.tx_ptr = _uds_ext_tx_packet_arr,
+	.tx_buf_size = sizeof(_uds_ext_tx_packet_arr),
+
+	.resp_pending_margin_ms = 50,
 
 	.dtc = {
-		.dtc_ptr = _dtc_arr_wrap.dtc_arr,
-		.num_dtc = sizeof(_dtc_arr_wrap.dtc_arr) / sizeof(uds_dtc_s),
+		.id_arr = _ext_dtc_id_arr,
+		.num_dtc = UDS_CONFIG_DTC_IDX_COUNT,
+		.st_arr = _ext_dtc_st_arr,
+		.st_bit_arr = _ext_dtc_st_bit_arr,
+		.avail_st_mask = 0x7F,
+		.deb_cfg_arr = _ext_dtc_deb_cfg_arr,
+		.deb_arr = _ext_dtc_deb_arr,
+		.nvm_addr = UDS_CONFIG_NVM_ADDR_EXT_DTC,
+		.snap_cfg_arr = _ext_dtc_snap_cfg_arr,
+		.snap_arr = _ext_dtc_snap_arr,
+		.num_snap = UDS_CONFIG_NUM_EXT_SNAP,
+		.snap_nvm_addr = UDS_CONFIG_NVM_ADDR_EXT_SNAP,
 		.nvm_write_func_ptr = nvm_write,
-		.nvm_read_func_ptr = nvm_read
+		.nvm_read_func_ptr = nvm_read,
+		.read_access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_ALL,
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(0)
+		},
+		.clear_access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_ALL,
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(0)
+		},
+		.setting_access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_BIT(2), // extended diagnostic session, see _available_diag_sess_arr
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(0)
+		},
+		.setting_cbk_ptr = uds_dtc_setting_on_changed
+	},
+
+	.comm_ctrl = {
+		.cbk_ptr = uds_comm_ctrl_on_changed,
+		.access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_BIT(2), // extended diagnostic session, see _available_diag_sess_arr
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(0)
+		}
+	},
+
+	.io_ctrl = {
+		.sig_arr = _ext_io_sig_arr,
+		.st_arr = _ext_io_st_arr,
+		.num_sig = UDS_CONFIG_IO_IDX_COUNT,
+		.access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_BIT(2),
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(0)
+		}
 	}
 };
 
-uds_handle_s _uds_handle;
+uds_ext_handle_s _uds_ext_handle;
@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+//! if button was pressed for this long, imagine that button was stuck
+#define UDS_CONFIG_BTN_STUCK_TIMEOUT_MS (5000)
+//! button sampling period, the resolution of the button stuck DTC debounce
+#define UDS_CONFIG_BTN_SAMPLE_PERIOD_MS (10)
+
 typedef enum {
 	UDS_CONFIG_DID_IDX_IMPL_VERSION = 0u,
 	UDS_CONFIG_DID_IDX_BLINK_DELAY,
@@ -15,6 +20,13 @@ typedef enum {
 	UDS_CONFIG_DTC_IDX_COUNT
 } uds_config_dtc_idx_e;
 
+//! Actuators the client can take over with input output control by identifier
+typedef enum {
+	UDS_CONFIG_IO_IDX_LED_BLUE = 0u,
+	UDS_CONFIG_IO_IDX_LED_GREEN,
+	UDS_CONFIG_IO_IDX_COUNT
+} uds_config_io_idx_e;
+
 uint16_t uds_config_get_blink_delay_ms(void);
 void uds_config_set_ecu_on_time_ms(uint64_t on_time_ms);
 
@@ -2,15 +2,117 @@
 #include "abs_tim_config.h"
 #include "stm32c0xx_hal.h"
 
-uint16_t abs_tim_u16_get(void)
+#if (ABS_TIM_TICK_HZ != 1000u)
+#error "core UDS timings and abs_tim_get_ms32 need millisecond ticks"
+#endif
+
+//! TIM14 counts milliseconds, a full period is 2^16 ms
+#define ABS_TIM_MS32_CNT_BITS 16u
+//! Overflow count bits which fit into the 32-bit time
+#define ABS_TIM_MS32_OVF_MASK 0xFFFFu
+
+static volatile uint32_t _abs_tim_ms32_ovf_count = 0;
+
+/**
+ * Overflow count and counter are read without disabling interrupts.
+ * If the update interrupt runs in between, the overflow count changes and the read is repeated.
+ * If the counter has wrapped but the interrupt is not served yet (e.g. read from an interrupt
+ * or with interrupts disabled), the pending update flag accounts for the missing overflow.
+ * TIM14 interrupt has the highest priority, so it can not be preempted by a reader
+ * between clearing the flag and incrementing the count.
+ */
+uint32_t abs_tim_get_ms32(void)
 {
-	return TIM14->CNT;
+	uint32_t ovf_count_before;
+	uint32_t ovf_count;
+	uint32_t cnt;
+
+	do {
+		ovf_count_before = _abs_tim_ms32_ovf_count;
+		ovf_count = ovf_count_before;
+		cnt = TIM14->CNT;
+		if((TIM14->SR & TIM_SR_UIF) != 0) {
+			// counter value might be from before the wrap, read it again
+			cnt = TIM14->CNT;
+			ovf_count++;
+		}
+	} while(ovf_count_before != _abs_tim_ms32_ovf_count);
+
+	return (ovf_count << ABS_TIM_MS32_CNT_BITS) | cnt;
+}
+
+uint32_t abs_tim_get_elapsed_ms32(uint32_t timestamp)
+{
+	// unsigned subtraction handles the wrap around
+	return abs_tim_get_ms32() - timestamp;
+}
+
+void abs_tim_ms32_ovf(void)
+{
+	_abs_tim_ms32_ovf_count++;
+
+	// core abs_tim is fed with the 32-bit time, it only needs its wrap around
+	if((_abs_tim_ms32_ovf_count & ABS_TIM_MS32_OVF_MASK) == 0) {
+		abs_tim_ovf();
+	}
+}
+
+uint32_t abs_tim_ticks_to_us(uint32_t ticks)
+{
+	return ticks * (1000000u / ABS_TIM_TICK_HZ);
+}
+
+uint32_t abs_tim_us_to_ticks(uint32_t us)
+{
+	return us / (1000000u / ABS_TIM_TICK_HZ);
+}
+
+/**
+ * Same scheme as abs_tim_get_ms32, the HAL tick is the overflow count of SysTick.
+ * SysTick counts down from LOAD, a pending SysTick interrupt with a freshly
+ * reloaded counter means the tick is not incremented yet.
+ */
+uint32_t abs_tim_get_cycle_stamp(void)
+{
+	uint32_t load = SysTick->LOAD;
+	uint32_t tick;
+	uint32_t val;
+	bool is_pending;
+
+	do {
+		tick = HAL_GetTick();
+		val = SysTick->VAL;
+		is_pending = ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0);
+	} while(tick != HAL_GetTick());
+
+	if(is_pending && (val > (load / 2u))) {
+		tick++;
+	}
+
+	// wraps around linearly, differences stay correct
+	return (tick * (load + 1u)) + (load - val);
+}
+
+uint32_t abs_tim_cycles_to_us(uint32_t cycles)
+{
+	return cycles / ABS_TIM_CYCLES_PER_US;
+}
+
+uint32_t abs_tim_cycles_to_ns(uint32_t cycles)
+{
+	return (cycles * 1000u) / ABS_TIM_CYCLES_PER_US;
 }
 
 abs_tim_cfg_s _abs_tim_cfg = {
-	.get_func_ptr = abs_tim_u16_get,
-	.hw_type = ABS_TIM_HW_TIM_16_BIT
+	.get_func_ptr = abs_tim_get_ms32,
+	.hw_type = ABS_TIM_HW_TIM_32_BIT
 };
 
 abs_tim_handle_s _abs_tim;
 
+tim_wheel_cfg_s _tim_wheel_cfg = {
+	.get_ms_func_ptr = abs_tim_get_ms32
+};
+
+tim_wheel_handle_s _tim_wheel;
+
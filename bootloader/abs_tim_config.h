@@ -2,5 +2,49 @@
 #define ABS_TIM_CONFIG_H_
 
 #include "abs_tim.h"
+#include "tim_wheel.h"
+
+//! Clock of TIM14 and SysTick, HSI without division
+#define ABS_TIM_CLK_HZ 48000000u
+//! CPU cycles per microsecond, cycle stamps are counted in CPU cycles
+#define ABS_TIM_CYCLES_PER_US (ABS_TIM_CLK_HZ / 1000000u)
+
+#ifndef ABS_TIM_TICK_HZ
+//! Tick rate of TIM14. The core UDS timings and the 32-bit API are in milliseconds.
+#define ABS_TIM_TICK_HZ 1000u
+#endif
+//! TIM14 prescaler which gives ABS_TIM_TICK_HZ
+#define ABS_TIM_PRESCALER ((ABS_TIM_CLK_HZ / ABS_TIM_TICK_HZ) - 1u)
+
+/**
+ * Conversion between abs_tim ticks and microseconds.
+ * ABS_TIM_TICK_HZ has to divide 1 MHz.
+ */
+uint32_t abs_tim_ticks_to_us(uint32_t ticks);
+uint32_t abs_tim_us_to_ticks(uint32_t us);
+
+/**
+ * Cycle stamp for profiling, CPU cycles derived from SysTick and the HAL tick.
+ * Wraps around after ~89 s at 48 MHz, the difference of two stamps is wrap safe.
+ * Lock-free, can be called from interrupts.
+ */
+uint32_t abs_tim_get_cycle_stamp(void);
+//! Convert a cycle stamp difference to microseconds
+uint32_t abs_tim_cycles_to_us(uint32_t cycles);
+//! Convert a cycle stamp difference to nanoseconds, cycles has to be less than ~89 ms
+uint32_t abs_tim_cycles_to_ns(uint32_t cycles);
+
+/**
+ * 32-bit millisecond time, wraps around after ~49.7 days.
+ * Cheaper than abs_tim_get on Cortex-M0+ which has no 64-bit arithmetic.
+ * Compare timestamps only through abs_tim_get_elapsed_ms32, it is wrap safe.
+ *
+ * Lock-free and consistent, can be called from interrupts without masking them.
+ */
+uint32_t abs_tim_get_ms32(void);
+uint32_t abs_tim_get_elapsed_ms32(uint32_t timestamp);
+
+//! To be called from the timer update interrupt, it also calls abs_tim_ovf when needed
+void abs_tim_ms32_ovf(void);
 
 #endif /* ABS_TIM_CONFIG_H_ */
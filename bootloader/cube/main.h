@@ -32,6 +32,7 @@ extern "C" {
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "isotp.h"
+#include <stdbool.h>
 /* USER CODE END Includes */
 
 /* Exported types ------------------------------------------------------------*/
@@ -65,6 +66,8 @@ typedef struct {
 
 /* USER CODE BEGIN EFP */
 extern ecu_handle_s _ecu_handle;
+void can_set_baudrate(uint32_t baudrate);
+bool can_is_tx_idle(void);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
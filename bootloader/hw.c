@@ -1,6 +1,7 @@
 #include <assert.h>
 #include "hw.h"
-#include "abs_tim.h"
+#include "abs_tim_config.h"
+#include "uart_log.h"
 
 hw_s _hw;
 
@@ -83,7 +84,7 @@ void MX_FDCAN1_Init(void)
 	_hw.hfdcan1.Init.AutoRetransmission = ENABLE;
 	_hw.hfdcan1.Init.TransmitPause = ENABLE;
 	_hw.hfdcan1.Init.ProtocolException = DISABLE;
-	_hw.hfdcan1.Init.NominalPrescaler = 1;
+	_hw.hfdcan1.Init.NominalPrescaler = HW_CAN_PRESCALER(HW_CAN_BAUDRATE_DEFAULT);
 	_hw.hfdcan1.Init.NominalSyncJumpWidth = 12;
 	_hw.hfdcan1.Init.NominalTimeSeg1 = 35;
 	_hw.hfdcan1.Init.NominalTimeSeg2 = 12;
@@ -100,7 +101,7 @@ void MX_FDCAN1_Init(void)
 void MX_TIM14_Init(void)
 {
 	_hw.htim14.Instance = TIM14;
-	_hw.htim14.Init.Prescaler = 47999;
+	_hw.htim14.Init.Prescaler = ABS_TIM_PRESCALER;
 	_hw.htim14.Init.CounterMode = TIM_COUNTERMODE_UP;
 	_hw.htim14.Init.Period = 65535;
 	_hw.htim14.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
@@ -143,7 +144,7 @@ void TIM3_IRQHandler(void) {while(1) {__asm__("nop");}}                   /* TIM
 void TIM14_IRQHandler(void)
 {
 	__HAL_TIM_CLEAR_FLAG(&_hw.htim14, TIM_FLAG_UPDATE);
-	abs_tim_ovf();
+	abs_tim_ms32_ovf();
 }
 
 void TIM15_IRQHandler(void) {while(1) {__asm__("nop");}}                  /* TIM15                                       */
@@ -153,7 +154,10 @@ void I2C1_IRQHandler(void) {while(1) {__asm__("nop");}}                   /* I2C
 void I2C2_IRQHandler(void) {while(1) {__asm__("nop");}}                   /* I2C1                                        */
 void SPI1_IRQHandler(void) {while(1) {__asm__("nop");}}                   /* SPI1                                        */
 void SPI2_IRQHandler(void) {while(1) {__asm__("nop");}}                   /* SPI1                                        */
-void USART1_IRQHandler(void) {while(1) {__asm__("nop");}}                 /* USART1                                      */
+void USART1_IRQHandler(void)
+{
+	uart_log_irq();
+}
 void USART2_IRQHandler(void) {while(1) {__asm__("nop");}}                 /* USART2                                      */
 void USART3_4_IRQHandler(void) {while(1) {__asm__("nop");}}               /* USART3 and USART4                           */
 //void FDCAN1_IT0_IRQHandler(void) {while(1) {__asm__("nop");}}             /* FDCAN1 interrupt request 0 pending          */
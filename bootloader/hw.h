@@ -9,6 +9,17 @@ typedef struct {
 	TIM_HandleTypeDef htim14;
 } hw_s;
 
+//! FDCAN kernel clock, PCLK1 from HSI
+#define HW_CAN_CLK_HZ 48000000u
+//! Time quanta per bit: sync segment, NominalTimeSeg1 and NominalTimeSeg2
+#define HW_CAN_TQ_PER_BIT 48u
+//! Nominal baudrate after reset, same as the application and the tester setup
+#define HW_CAN_BAUDRATE_DEFAULT 1000000u
+//! Nominal baudrate the tester may switch to, e.g. for a bus with slower nodes
+#define HW_CAN_BAUDRATE_ALT 500000u
+//! NominalPrescaler of a baudrate in bit/s, HW_CAN_CLK_HZ / HW_CAN_TQ_PER_BIT must be a multiple of it
+#define HW_CAN_PRESCALER(baudrate) (HW_CAN_CLK_HZ / (HW_CAN_TQ_PER_BIT * (baudrate)))
+
 void SystemClock_Config(void);
 void MX_GPIO_Init(void);
 void MX_USART1_UART_Init(void);
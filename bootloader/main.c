@@ -3,10 +3,25 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "uds.h"
+#include "uds_ext.h"
 #include "addr.h"
+#include "abs_tim_config.h"
+#include "evt_sched.h"
+#include "uart_log.h"
+#include "trace.h"
 
 #define UDS_RESP_ID (0x761)
 #define UDS_REQ_ID (0x760)
+#define LED_TOGGLE_PERIOD_MS (3000)
+//! period of the ISO-TP and UDS timeouts, requests are served right away on reception
+#define POLL_PERIOD_MS (10)
+
+typedef enum {
+	EVT_CAN_RX, // CAN frame is passed to ISO-TP
+	EVT_ISOTP_TX, // ISO-TP has consecutive frames to send
+	EVT_TICK, // HAL tick at which a timer wheel timer is due
+	EVT_COUNT
+} evt_e;
 
 ecu_handle_s _ecu_handle = {
 	.tx_header = {
@@ -24,6 +39,11 @@ ecu_handle_s _ecu_handle = {
 
 extern uint32_t _bl_flag;
 
+static tim_wheel_tim_s _led_tim;
+static tim_wheel_tim_s _poll_tim;
+static volatile uint32_t _tick_due_ms; // HAL tick of the earliest timer wheel expiry
+static volatile bool _is_tick_due; // false if no timer is active
+
 void isotp_user_debug(const char* message, ...)
 {
 	return;
@@ -75,20 +95,139 @@ static void can_setup(void)
 	HAL_FDCAN_Start(&_hw.hfdcan1);
 }
 
-int main(void)
+// switches the nominal bitrate, called by link control once the bus is idle
+void can_set_baudrate(uint32_t baudrate)
+{
+	HAL_FDCAN_Stop(&_hw.hfdcan1);
+	_hw.hfdcan1.Init.NominalPrescaler = HW_CAN_PRESCALER(baudrate);
+	// init clears the message RAM, so filters and notifications are set up again
+	HAL_FDCAN_Init(&_hw.hfdcan1);
+	can_setup();
+	UART_LOG_INF("baudrate:%lu\n", (unsigned long)baudrate);
+}
+
+bool can_is_tx_idle(void)
+{
+	return
+		(_ecu_handle.isotp_link.send_status != ISOTP_SEND_STATUS_INPROGRESS) &&
+		(HAL_FDCAN_IsTxBufferMessagePending(
+			&_hw.hfdcan1,
+			FDCAN_TX_BUFFER0 | FDCAN_TX_BUFFER1 | FDCAN_TX_BUFFER2
+		) == 0U);
+}
+
+static void led_toggle(void *arg_ptr)
+{
+	(void)arg_ptr;
+	HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_9);
+}
+
+static void go_to_app_check(void)
 {
-	uint8_t payload_arr[255] = {0};
+	if(
+		(*ADDR_BL_FLAG_PTR == ADDR_BL_FLAG_SWITCH_EXTD_SESS) ||
+		(*ADDR_BL_FLAG_PTR == ADDR_BL_FLAG_SWITCH_GO_TO_APP)
+	) {
+		uart_log_flush();
+		__disable_irq();
+		// bootloader flag is cleared, jump to application
+		uint32_t app_addr = ADDR_APP; // Application start address
+		__set_MSP(*(uint32_t *)app_addr);
+		void (*app_reset)(void) = (void (*)(void))(*((uint32_t *)(app_addr + 4)));
+		app_reset();
+	}
+}
+
+static void uds_process(void)
+{
+	static uint8_t payload_arr[255] = {0};
 	uint16_t out_size = 0;
 	int ret;
 
+	isotp_poll(&_ecu_handle.isotp_link);
+	ret = isotp_receive(
+		&_ecu_handle.isotp_link,
+		payload_arr,
+		sizeof(payload_arr),
+		&out_size
+	);
+	if(
+		(ret == ISOTP_RET_OK) &&
+		!uds_ext_put_packet_in(payload_arr, out_size)
+	) {
+		uds_put_packet_in(payload_arr, out_size);
+	}
+	uds_handler();
+	uds_ext_handler();
+
+	if(_ecu_handle.isotp_link.send_status == ISOTP_SEND_STATUS_INPROGRESS) {
+		evt_sched_post(EVT_ISOTP_TX);
+	}
+
+	go_to_app_check();
+}
+
+// timeouts of ISO-TP and the UDS core and extension
+static void poll_process(void *arg_ptr)
+{
+	(void)arg_ptr;
+	uds_process();
+}
+
+static void tick_process(void)
+{
+	tim_wheel_handler();
+}
+
+static void sched_idle(void)
+{
+	uint32_t remaining_ms = 0;
+
+	__disable_irq();
+	if(!evt_sched_is_pending()) {
+		// the tick wakes the scheduler only when the next timer is due
+		_is_tick_due = tim_wheel_get_next_expiry(&remaining_ms);
+		_tick_due_ms = HAL_GetTick() + remaining_ms;
+		__WFI(); // wakes up on a pending interrupt even with interrupts disabled
+	}
+	__enable_irq();
+}
+
+static const evt_sched_handler_t _evt_handler_arr[EVT_COUNT] = {
+	[EVT_CAN_RX] = uds_process,
+	[EVT_ISOTP_TX] = uds_process,
+	[EVT_TICK] = tick_process
+};
+
+evt_sched_cfg_s _evt_sched_cfg = {
+	.handler_ptr = _evt_handler_arr,
+	.num_evt = EVT_COUNT,
+	.idle_func_ptr = sched_idle
+};
+
+evt_sched_handle_s _evt_sched;
+
+void HAL_IncTick(void)
+{
+	uwTick += (uint32_t)uwTickFreq;
+	if(_is_tick_due && ((int32_t)(uwTick - _tick_due_ms) >= 0)) {
+		evt_sched_post(EVT_TICK);
+	}
+}
+
+int main(void)
+{
 	HAL_Init();
 	SystemClock_Config();
 	MX_GPIO_Init();
 	MX_USART1_UART_Init();
+	uart_log_init();
 	MX_FDCAN1_Init();
 	MX_TIM14_Init();
 
-	HAL_TIM_Base_Start(&_hw.htim14);
+	// update interrupt counts the overflows of the 16-bit timer
+	__HAL_TIM_CLEAR_FLAG(&_hw.htim14, TIM_FLAG_UPDATE);
+	HAL_TIM_Base_Start_IT(&_hw.htim14);
 
 	// Initialize hardware
 	__HAL_TIM_ENABLE(&_hw.htim14);
@@ -102,53 +241,29 @@ int main(void)
 		sizeof(_ecu_handle.isotp_rx_arr)
 	);
 	abs_tim_init();
+	trace_init();
+	tim_wheel_init();
+	evt_sched_init();
 
 	if(*ADDR_BL_FLAG_PTR == ADDR_BL_FLAG_SWITCH_PROG_SESS) {
 		_uds_cfg.startup_diag_sess = UDS_DIAG_SESS_PROG;
 		_uds_cfg.generate_pos_resp_prog = true;
 		*ADDR_BL_FLAG_PTR = ADDR_BL_FLAG_NONE; // Clear the flag
-		printf("BL in prog sess\n");
+		UART_LOG_INF("BL in prog sess\n");
 	} else {
 		*ADDR_BL_FLAG_PTR = ADDR_BL_FLAG_SWITCH_GO_TO_APP;
 	}
 
 	uds_init();
+	uds_ext_init();
 
-	printf("Bootloader started\n");
-	uint64_t led_timestamp = abs_tim_get();
+	UART_LOG_INF("Bootloader started\n");
+	tim_wheel_start(&_led_tim, led_toggle, NULL, LED_TOGGLE_PERIOD_MS, LED_TOGGLE_PERIOD_MS);
+	tim_wheel_start(&_poll_tim, poll_process, NULL, 0, POLL_PERIOD_MS);
 
-	while(1) {
-		isotp_poll(&_ecu_handle.isotp_link);
-		ret = isotp_receive(
-			&_ecu_handle.isotp_link,
-			payload_arr,
-			sizeof(payload_arr),
-			&out_size
-		);
-		if(ret == ISOTP_RET_OK) {
-			uds_put_packet_in(payload_arr, out_size);
-		}
-		uds_handler();
-
-
-		if(abs_tim_get_elapsed(led_timestamp) >= 3000) {
-			led_timestamp = abs_tim_get();
-			HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_9);
-		}
-
-
-		if(
-			(*ADDR_BL_FLAG_PTR == ADDR_BL_FLAG_SWITCH_EXTD_SESS) ||
-			(*ADDR_BL_FLAG_PTR == ADDR_BL_FLAG_SWITCH_GO_TO_APP)
-		) {
-			__disable_irq();
-			// bootloader flag is cleared, jump to application
-			uint32_t app_addr = ADDR_APP; // Application start address
-			__set_MSP(*(uint32_t *)app_addr);
-			void (*app_reset)(void) = (void (*)(void))(*((uint32_t *)(app_addr + 4)));
-			app_reset();
-		}
-	}
+	// the poll timer is due at once, so the bootloader flag is evaluated before the first event
+	evt_sched_post(EVT_TICK);
+	evt_sched_run();
 	return 0;
 }
 
@@ -168,11 +283,11 @@ void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
 			_ecu_handle.rx_data_arr,
 			_ecu_handle.rx_header.DataLength
 		);
+		evt_sched_post(EVT_CAN_RX);
 	}
 }
 
 int __io_putchar(int ch)
 {
-	HAL_UART_Transmit(&_hw.huart1, (uint8_t *)&ch, 1, HAL_MAX_DELAY);
-	return ch;
+	return uart_log_putchar(ch);
 }
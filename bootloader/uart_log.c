@@ -0,0 +1,69 @@
+#include "uart_log.h"
+#include "hw.h"
+
+#define UART_LOG_BUF_MASK (UART_LOG_BUF_SIZE - 1u)
+
+#if (UART_LOG_BUF_SIZE & UART_LOG_BUF_MASK) != 0
+#error "UART_LOG_BUF_SIZE has to be a power of two"
+#endif
+
+static uint8_t _uart_log_buf_arr[UART_LOG_BUF_SIZE];
+//! written only by the producer (main context)
+static volatile uint32_t _uart_log_head = 0;
+//! written only by the transmit interrupt
+static volatile uint32_t _uart_log_tail = 0;
+static volatile uint32_t _uart_log_drop_count = 0;
+
+void uart_log_init(void)
+{
+	HAL_NVIC_SetPriority(USART1_IRQn, 3, 0); // lowest, logging is never urgent
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+int uart_log_putchar(int ch)
+{
+	uint32_t head = _uart_log_head;
+
+	if((head - _uart_log_tail) >= UART_LOG_BUF_SIZE) {
+		_uart_log_drop_count++;
+		return ch;
+	}
+
+	_uart_log_buf_arr[head & UART_LOG_BUF_MASK] = (uint8_t)ch;
+	_uart_log_head = head + 1;
+	__HAL_UART_ENABLE_IT(&_hw.huart1, UART_IT_TXE);
+	return ch;
+}
+
+void uart_log_irq(void)
+{
+	uint32_t tail = _uart_log_tail;
+
+	if((tail != _uart_log_head) && (__HAL_UART_GET_FLAG(&_hw.huart1, UART_FLAG_TXE) != 0)) {
+		_hw.huart1.Instance->TDR = _uart_log_buf_arr[tail & UART_LOG_BUF_MASK];
+		tail++;
+		_uart_log_tail = tail;
+	}
+
+	if(tail == _uart_log_head) {
+		__HAL_UART_DISABLE_IT(&_hw.huart1, UART_IT_TXE);
+	}
+}
+
+void uart_log_flush(void)
+{
+	// polled, the interrupt must not drain the ring at the same time
+	HAL_NVIC_DisableIRQ(USART1_IRQn);
+	while(_uart_log_tail != _uart_log_head) {
+		uart_log_irq();
+	}
+	while(__HAL_UART_GET_FLAG(&_hw.huart1, UART_FLAG_TC) == 0) {
+		__asm__("nop");
+	}
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+uint32_t uart_log_get_drop_count(void)
+{
+	return _uart_log_drop_count;
+}
@@ -1,8 +1,13 @@
 #include "uds.h"
+#include "uds_ext.h"
 #include "main.h"
+#include "hw.h"
 #include "abs_tim.h"
 #include "stm32c0xx_hal.h"
 #include <stdio.h>
+#include "uart_log.h"
+#include "trace.h"
+#include "abs_tim_config.h"
 #include <assert.h>
 #include "addr.h"
 
@@ -27,7 +32,9 @@ uint32_t _bl_flag __attribute__((section(".bl_flag_s")));
 
 static void uds_diag_sess_on_changed(uint8_t new_sess)
 {
-	printf("sess:%d\n", (int)new_sess);
+	UART_LOG_INF("sess:%d\n", (int)new_sess);
+	TRACE1(TRACE_ID_DIAG_SESS, new_sess);
+	uds_ext_abort(new_sess);
 	switch(new_sess) {
 	case UDS_DIAG_SESS_PROG:
 		break;
@@ -42,7 +49,9 @@ static void uds_diag_sess_on_changed(uint8_t new_sess)
 
 static void uds_ecu_reset(uint8_t reset_type)
 {
-	printf("reset:%d\n", (int)reset_type);
+	UART_LOG_INF("reset:%d\n", (int)reset_type);
+	TRACE1(TRACE_ID_ECU_RESET, reset_type);
+	uart_log_flush();
 	HAL_NVIC_SystemReset();
 	while (1) {
 		__asm__("nop");
@@ -52,7 +61,8 @@ static void uds_ecu_reset(uint8_t reset_type)
 
 static void uds_security_level_on_changed(uint8_t new_level)
 {
-	printf("level:%d\n", (int)new_level);
+	UART_LOG_INF("level:%d\n", (int)new_level);
+	TRACE1(TRACE_ID_SECURITY_LEVEL, new_level);
 	return;
 }
 
@@ -61,11 +71,11 @@ static void uds_rid_check_prog_precond(void *arg_rid_ptr)
 	uds_rid_s *rid_ptr = (uds_rid_s *)arg_rid_ptr;
 	switch (rid_ptr->curr_state) {
 	case UDS_RID_STATE_START:
-		printf("start precond\n");
+		UART_LOG_INF("start precond\n");
 		rid_ptr->curr_state = UDS_RID_STATE_RUNNING;
 		break;
 	case UDS_RID_STATE_RUNNING:
-		printf("done precond\n");
+		UART_LOG_INF("done precond\n");
 		rid_ptr->curr_state = UDS_RID_STATE_DONE;
 		break;
 	default:
@@ -78,11 +88,11 @@ static void uds_rid_erase_flash(void *arg_rid_ptr)
 	uds_rid_s *rid_ptr = (uds_rid_s *)arg_rid_ptr;
 	switch (rid_ptr->curr_state) {
 	case UDS_RID_STATE_START:
-		printf("start erase\n");
+		UART_LOG_INF("start erase\n");
 		rid_ptr->curr_state = UDS_RID_STATE_RUNNING;
 		break;
 	case UDS_RID_STATE_RUNNING:
-		printf("done erase\n");
+		UART_LOG_INF("done erase\n");
 		rid_ptr->curr_state = UDS_RID_STATE_DONE;
 		break;
 	default:
@@ -95,11 +105,11 @@ static void uds_rid_check_mem(void *arg_rid_ptr)
 	uds_rid_s *rid_ptr = (uds_rid_s *)arg_rid_ptr;
 	switch (rid_ptr->curr_state) {
 	case UDS_RID_STATE_START:
-		printf("start mem\n");
+		UART_LOG_INF("start mem\n");
 		rid_ptr->curr_state = UDS_RID_STATE_RUNNING;
 		break;
 	case UDS_RID_STATE_RUNNING:
-		printf("done mem\n");
+		UART_LOG_INF("done mem\n");
 		rid_ptr->curr_state = UDS_RID_STATE_DONE;
 		break;
 	default:
@@ -112,11 +122,11 @@ static void uds_rid_check_prog_dependency(void *arg_rid_ptr)
 	uds_rid_s *rid_ptr = (uds_rid_s *)arg_rid_ptr;
 	switch (rid_ptr->curr_state) {
 	case UDS_RID_STATE_START:
-		printf("start depen\n");
+		UART_LOG_INF("start depen\n");
 		rid_ptr->curr_state = UDS_RID_STATE_RUNNING;
 		break;
 	case UDS_RID_STATE_RUNNING:
-		printf("done depen\n");
+		UART_LOG_INF("done depen\n");
 		rid_ptr->curr_state = UDS_RID_STATE_DONE;
 		break;
 	default:
@@ -140,7 +150,7 @@ static bool uds_routine_download(void *arg_handle_ptr)
 static void uds_req_transfer_exit(void)
 {
 	HAL_FLASH_Lock();
-	printf("exit\n");
+	UART_LOG_INF("exit\n");
 }
 
 static FLASH_EraseInitTypeDef _flash_erase_init_type = {
@@ -157,7 +167,8 @@ static bool uds_transfer_data_erase_page(uds_transfer_data_s *transfer_data_ptr)
 	uint32_t page_err = 0xFFFFFFFFU;
 
 	if(is_page_erased_idx >= sizeof(_is_page_erased) / sizeof(_is_page_erased[0])) {
-		printf("Error: Page index out of bounds\n");
+		UART_LOG_ERR("Error: Page index out of bounds\n");
+		TRACE2(TRACE_ID_PROG_ERR, TRACE_PROG_ERR_PAGE_OUT_OF_BOUNDS, page_idx);
 		return false;
 	} else {
 		if(!_is_page_erased[is_page_erased_idx]) {
@@ -165,10 +176,11 @@ static bool uds_transfer_data_erase_page(uds_transfer_data_s *transfer_data_ptr)
 			// Erase the page if it is not erased yet
 			HAL_FLASH_Unlock();
 			if(FLASH->CR & FLASH_CR_LOCK) {
-				printf("lock\n");
+				UART_LOG_DBG("lock\n");
+				TRACE2(TRACE_ID_PROG_ERR, TRACE_PROG_ERR_FLASH_LOCKED, page_idx);
 				return false;
 			} else {
-				printf("unlock\n");
+				UART_LOG_DBG("unlock\n");
 			}
 			__HAL_FLASH_CLEAR_FLAG(
 				FLASH_FLAG_EOP |
@@ -178,12 +190,15 @@ static bool uds_transfer_data_erase_page(uds_transfer_data_s *transfer_data_ptr)
 			);
 			HAL_FLASHEx_Erase(&_flash_erase_init_type, &page_err);
 			HAL_FLASH_Lock();
+			uds_ext_keep_alive();
 			if(page_err != 0xFFFFFFFFU) {
-				printf("Error: Page erase failed at index %lu\n", (unsigned long)page_idx);
+				UART_LOG_ERR("Error: Page erase failed at index %lu\n", (unsigned long)page_idx);
+				TRACE2(TRACE_ID_PROG_ERR, TRACE_PROG_ERR_ERASE, page_idx);
 				return false;
 			} else {
 				_is_page_erased[is_page_erased_idx] = true;
-				printf("Page %lu erased\n", (unsigned long)page_idx);
+				UART_LOG_DBG("Page %lu erased\n", (unsigned long)page_idx);
+				TRACE1(TRACE_ID_PAGE_ERASED, page_idx);
 			}
 		}
 	}
@@ -204,7 +219,8 @@ static void uds_transfer_data(void *arg_handle_ptr)
 		(transfer_data_ptr->data_ptr == NULL) ||
 		(transfer_data_ptr->recv_size == 0)
 	) {
-		printf("Error: Invalid transfer data\n");
+		UART_LOG_ERR("Error: Invalid transfer data\n");
+		TRACE1(TRACE_ID_PROG_ERR, TRACE_PROG_ERR_INVALID_DATA);
 		return;
 	}
 
@@ -215,16 +231,23 @@ static void uds_transfer_data(void *arg_handle_ptr)
 	int64_t app_idx = transfer_data_ptr->mem_addr - ADDR_APP;
 
 	if(app_idx < 0) {
-		printf("Error: Invalid mem addr transfer data\n");
+		UART_LOG_ERR("Error: Invalid mem addr transfer data\n");
+		TRACE2(TRACE_ID_PROG_ERR, TRACE_PROG_ERR_INVALID_ADDR, transfer_data_ptr->mem_addr);
 		return;
 	}
 
-	printf(
+	UART_LOG_DBG(
 		"address: %lx recv size: %lu bsc:%lu\n",
 		(unsigned long)transfer_data_ptr->mem_addr,
 		(unsigned long)transfer_data_ptr->recv_size,
 		(unsigned long)transfer_data_ptr->bsc
 	);
+	TRACE3(
+		TRACE_ID_BLOCK_RECV,
+		transfer_data_ptr->mem_addr,
+		transfer_data_ptr->recv_size,
+		transfer_data_ptr->bsc
+	);
 
 	for(uint32_t i = 0; i < transfer_data_ptr->recv_size;) {
 		u64 = 0;
@@ -249,9 +272,11 @@ static void uds_transfer_data(void *arg_handle_ptr)
 		u64_ptr = (volatile uint64_t *)(addr);
 
 		if(*u64_ptr != u64) {
-			printf("Error: Flash write failed at address %lx\n", addr);
+			UART_LOG_ERR("Error: Flash write failed at address %lx\n", addr);
+			TRACE2(TRACE_ID_PROG_ERR, TRACE_PROG_ERR_WRITE, addr);
 			return;
 		}
+		uds_ext_keep_alive();
 	}
 }
 
@@ -430,6 +455,7 @@ static uds_did_s _did_arr[] = {
 };
 
 static uint8_t uds_transfer_data_arr[128]; // Buffer for transfer data
+static uint8_t _uds_ext_tx_packet_arr[ISOTP_BUFSIZE] = {0};
 
 uds_cfg_s _uds_cfg = {
 	.is_serv_en = {
@@ -519,3 +545,67 @@ uds_cfg_s _uds_cfg = {
 };
 
 uds_handle_s _uds_handle;
+
+trace_cfg_s _trace_cfg = {
+	.get_ts_func_ptr = abs_tim_get_ms32,
+	.is_en = true
+};
+
+trace_handle_s _trace;
+
+static const uds_ext_mem_region_s _upload_region_arr[] = {
+	{ // application
+		.addr = ADDR_APP,
+		.size = ADDR_APP_LENGTH
+	},
+	{ // nvm page written by application
+		.addr = ADDR_NVM,
+		.size = ADDR_NVM_LENGTH
+	},
+	{ // binary trace log, decoded with tools/trace_decode.py
+		.addr = (uint32_t)&_trace,
+		.size = sizeof(_trace)
+	}
+};
+
+//! Baudrates the tester may switch to, HW_CAN_BAUDRATE_DEFAULT is always supported
+static const uint32_t _link_baudrate_arr[] = {
+	HW_CAN_BAUDRATE_ALT
+};
+
+const uds_ext_cfg_s _uds_ext_cfg = {
+	.is_serv_en = {
+		.req_upload = true,
+		.link_ctrl = true
+	},
+
+	// it should be able to hold a whole upload block
+	.tx_ptr = _uds_ext_tx_packet_arr,
+	.tx_buf_size = sizeof(_uds_ext_tx_packet_arr),
+
+	.resp_pending_margin_ms = 50,
+
+	.upload = {
+		.region_ptr = _upload_region_arr,
+		.num_region = sizeof(_upload_region_arr) / sizeof(uds_ext_mem_region_s),
+		.block_size = sizeof(_uds_ext_tx_packet_arr), // isotp tx buffer holds the whole block
+		.access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_ALL,
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(3)
+		}
+	},
+
+	.link_ctrl = {
+		.baudrate_arr = _link_baudrate_arr,
+		.num_baudrate = sizeof(_link_baudrate_arr) / sizeof(uint32_t),
+		.default_baudrate = HW_CAN_BAUDRATE_DEFAULT,
+		.set_baudrate_func_ptr = can_set_baudrate,
+		.is_tx_idle_func_ptr = can_is_tx_idle,
+		.access = {
+			.diag_sess_mask = UDS_EXT_DIAG_SESS_BIT(1), // programming session, see _available_diag_sess_arr
+			.security_level_mask = UDS_EXT_SEC_LEVEL_MIN(0)
+		}
+	}
+};
+
+uds_ext_handle_s _uds_ext_handle;
@@ -0,0 +1,95 @@
+#include "evt_sched.h"
+#include <assert.h>
+#include <stddef.h>
+
+void evt_sched_x_init(
+	evt_sched_handle_s *handle_ptr,
+	evt_sched_cfg_s *cfg_ptr
+)
+{
+	assert(handle_ptr != NULL);
+	assert(cfg_ptr != NULL);
+	assert(cfg_ptr->handler_ptr != NULL);
+	assert(cfg_ptr->num_evt <= EVT_SCHED_MAX_EVT);
+	assert(cfg_ptr->idle_func_ptr != NULL);
+
+	for(uint8_t i = 0; i < cfg_ptr->num_evt; ++i) {
+		assert(cfg_ptr->handler_ptr[i] != NULL);
+	}
+
+	handle_ptr->cfg_ptr = cfg_ptr;
+	for(uint8_t i = 0; i < EVT_SCHED_MAX_EVT; ++i) {
+		handle_ptr->pending_arr[i] = 0;
+	}
+	handle_ptr->is_init = true;
+}
+
+void evt_sched_x_post(evt_sched_handle_s *handle_ptr, uint8_t evt)
+{
+	assert(evt < EVT_SCHED_MAX_EVT);
+
+	// byte store, no read-modify-write which an interrupt could break
+	handle_ptr->pending_arr[evt] = 1;
+}
+
+bool evt_sched_x_is_pending(const evt_sched_handle_s *handle_ptr)
+{
+	for(uint8_t i = 0; i < handle_ptr->cfg_ptr->num_evt; ++i) {
+		if(handle_ptr->pending_arr[i] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool evt_sched_x_run_once(evt_sched_handle_s *handle_ptr)
+{
+	bool is_run = false;
+
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->is_init);
+
+	for(uint8_t i = 0; i < handle_ptr->cfg_ptr->num_evt; ++i) {
+		if(handle_ptr->pending_arr[i] != 0) {
+			// cleared before the handler, a post during the handler is not lost
+			handle_ptr->pending_arr[i] = 0;
+			handle_ptr->cfg_ptr->handler_ptr[i]();
+			is_run = true;
+		}
+	}
+	return is_run;
+}
+
+void evt_sched_x_run(evt_sched_handle_s *handle_ptr)
+{
+	while(1) {
+		if(!evt_sched_x_run_once(handle_ptr)) {
+			handle_ptr->cfg_ptr->idle_func_ptr();
+		}
+	}
+}
+
+void evt_sched_init(void)
+{
+	evt_sched_x_init(&_evt_sched, &_evt_sched_cfg);
+}
+
+void evt_sched_post(uint8_t evt)
+{
+	evt_sched_x_post(&_evt_sched, evt);
+}
+
+bool evt_sched_is_pending(void)
+{
+	return evt_sched_x_is_pending(&_evt_sched);
+}
+
+bool evt_sched_run_once(void)
+{
+	return evt_sched_x_run_once(&_evt_sched);
+}
+
+void evt_sched_run(void)
+{
+	evt_sched_x_run(&_evt_sched);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file evt_sched.h
+ * @brief Cooperative event scheduler.
+ * Modules post events, e.g. from interrupts, and the handler of an event runs
+ * in the main loop only when the event is pending. If no event is pending,
+ * the idle function is called which is expected to sleep until the next interrupt.
+ *
+ * Posting is a single byte store, so it is safe from interrupts without masking them.
+ * To not miss an event posted right before sleeping, the idle function should be:
+ *
+ *    __disable_irq();
+ *    if(!evt_sched_is_pending()) {
+ *        __WFI(); // wakes up on a pending interrupt even with interrupts disabled
+ *    }
+ *    __enable_irq();
+ *
+ * @warning It is mandatory to create the following global variables in your application:
+ * evt_sched_cfg_s _evt_sched_cfg;
+ * evt_sched_handle_s _evt_sched;
+ */
+
+#ifndef EVT_SCHED_H
+#define EVT_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef EVT_SCHED_MAX_EVT
+//! Maximum number of events
+#define EVT_SCHED_MAX_EVT 8
+#endif
+
+typedef void (*evt_sched_handler_t)(void);
+typedef void (*evt_sched_idle_func_t)(void);
+
+/**
+ * @brief Configuration structure of the event scheduler.
+ */
+typedef struct {
+	/// Pointer to the event handlers, indexed by event id.
+	/// Lower event ids are served first.
+	const evt_sched_handler_t *handler_ptr;
+	uint8_t num_evt; //!< number of events, at most EVT_SCHED_MAX_EVT
+	evt_sched_idle_func_t idle_func_ptr; //!< called when no event is pending, mandatory
+} evt_sched_cfg_s;
+
+/**
+ * @brief Event scheduler handle structure.
+ */
+typedef struct {
+	evt_sched_cfg_s *cfg_ptr;
+	volatile uint8_t pending_arr[EVT_SCHED_MAX_EVT]; //!< non zero if the event is pending
+	bool is_init;
+} evt_sched_handle_s;
+
+void evt_sched_x_init(
+	evt_sched_handle_s *handle_ptr,
+	evt_sched_cfg_s *cfg_ptr
+);
+
+//! Mark an event as pending, can be called from interrupts
+void evt_sched_x_post(evt_sched_handle_s *handle_ptr, uint8_t evt);
+
+bool evt_sched_x_is_pending(const evt_sched_handle_s *handle_ptr);
+
+/**
+ * @brief Run the handlers of all pending events once.
+ *
+ * @return true if at least one handler has run.
+ */
+bool evt_sched_x_run_once(evt_sched_handle_s *handle_ptr);
+
+//! Run the scheduler forever, idle function is called if nothing is pending
+void evt_sched_x_run(evt_sched_handle_s *handle_ptr);
+
+void evt_sched_init(void);
+void evt_sched_post(uint8_t evt);
+bool evt_sched_is_pending(void);
+bool evt_sched_run_once(void);
+void evt_sched_run(void);
+
+extern evt_sched_handle_s _evt_sched;
+extern evt_sched_cfg_s _evt_sched_cfg;
+
+#endif // EVT_SCHED_H
@@ -0,0 +1,225 @@
+#include "tim_wheel.h"
+#include <assert.h>
+#include <string.h>
+
+#define TIM_WHEEL_SLOT_MASK (TIM_WHEEL_NUM_SLOT - 1u)
+
+static uint32_t tim_wheel_x_now(const tim_wheel_handle_s *handle_ptr)
+{
+	return handle_ptr->cfg_ptr->get_ms_func_ptr();
+}
+
+//! wrap safe a <= b on 32-bit timestamps
+static bool tim_wheel_is_due(uint32_t expiry_ms, uint32_t now_ms)
+{
+	return (int32_t)(expiry_ms - now_ms) <= 0;
+}
+
+static void tim_wheel_x_link(tim_wheel_handle_s *handle_ptr, tim_wheel_tim_s *tim_ptr)
+{
+	tim_wheel_tim_s **head_ptr = &handle_ptr->slot_arr[tim_ptr->expiry_ms & TIM_WHEEL_SLOT_MASK];
+
+	// the handler has already processed curr_ms, expire in the next one at the earliest
+	if(tim_wheel_is_due(tim_ptr->expiry_ms, handle_ptr->curr_ms)) {
+		tim_ptr->expiry_ms = handle_ptr->curr_ms + 1;
+		head_ptr = &handle_ptr->slot_arr[tim_ptr->expiry_ms & TIM_WHEEL_SLOT_MASK];
+	}
+
+	tim_ptr->prev_ptr = NULL;
+	tim_ptr->next_ptr = *head_ptr;
+	if(*head_ptr != NULL) {
+		(*head_ptr)->prev_ptr = tim_ptr;
+	}
+	*head_ptr = tim_ptr;
+	tim_ptr->is_active = true;
+	handle_ptr->num_active++;
+}
+
+static void tim_wheel_x_unlink(tim_wheel_handle_s *handle_ptr, tim_wheel_tim_s *tim_ptr)
+{
+	if(tim_ptr->prev_ptr != NULL) {
+		tim_ptr->prev_ptr->next_ptr = tim_ptr->next_ptr;
+	} else {
+		handle_ptr->slot_arr[tim_ptr->expiry_ms & TIM_WHEEL_SLOT_MASK] = tim_ptr->next_ptr;
+	}
+	if(tim_ptr->next_ptr != NULL) {
+		tim_ptr->next_ptr->prev_ptr = tim_ptr->prev_ptr;
+	}
+	tim_ptr->next_ptr = NULL;
+	tim_ptr->prev_ptr = NULL;
+	tim_ptr->is_active = false;
+	handle_ptr->num_active--;
+}
+
+/**
+ * Fires the due timers of a slot one by one.
+ * The slot is scanned again after each callback, it may start or cancel any timer.
+ */
+static void tim_wheel_x_process_slot(tim_wheel_handle_s *handle_ptr, uint32_t slot, uint32_t now_ms)
+{
+	tim_wheel_tim_s *tim_ptr = handle_ptr->slot_arr[slot];
+
+	while(tim_ptr != NULL) {
+		if(!tim_wheel_is_due(tim_ptr->expiry_ms, now_ms)) {
+			tim_ptr = tim_ptr->next_ptr; // due in a later round
+			continue;
+		}
+
+		tim_wheel_x_unlink(handle_ptr, tim_ptr);
+		if(tim_ptr->period_ms != 0) {
+			tim_ptr->expiry_ms += tim_ptr->period_ms;
+			if(tim_wheel_is_due(tim_ptr->expiry_ms, now_ms)) {
+				tim_ptr->expiry_ms = now_ms + tim_ptr->period_ms; // missed periods are skipped
+			}
+			tim_wheel_x_link(handle_ptr, tim_ptr);
+		}
+		tim_ptr->cbk_ptr(tim_ptr->arg_ptr);
+
+		tim_ptr = handle_ptr->slot_arr[slot];
+	}
+}
+
+void tim_wheel_x_init(
+	tim_wheel_handle_s *handle_ptr,
+	tim_wheel_cfg_s *cfg_ptr
+)
+{
+	assert(handle_ptr != NULL);
+	assert(cfg_ptr != NULL);
+	assert(cfg_ptr->get_ms_func_ptr != NULL);
+	assert((TIM_WHEEL_NUM_SLOT & TIM_WHEEL_SLOT_MASK) == 0); // power of two
+
+	(void)memset(handle_ptr, 0, sizeof(tim_wheel_handle_s));
+	handle_ptr->cfg_ptr = cfg_ptr;
+	handle_ptr->curr_ms = tim_wheel_x_now(handle_ptr);
+	handle_ptr->is_init = true;
+}
+
+void tim_wheel_x_start(
+	tim_wheel_handle_s *handle_ptr,
+	tim_wheel_tim_s *tim_ptr,
+	tim_wheel_cbk_t cbk_ptr,
+	void *arg_ptr,
+	uint32_t timeout_ms,
+	uint32_t period_ms
+)
+{
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->is_init);
+	assert(tim_ptr != NULL);
+	assert(cbk_ptr != NULL);
+
+	if(tim_ptr->is_active) {
+		tim_wheel_x_unlink(handle_ptr, tim_ptr);
+	}
+
+	tim_ptr->cbk_ptr = cbk_ptr;
+	tim_ptr->arg_ptr = arg_ptr;
+	tim_ptr->period_ms = period_ms;
+	tim_ptr->expiry_ms = tim_wheel_x_now(handle_ptr) + timeout_ms;
+	tim_wheel_x_link(handle_ptr, tim_ptr);
+}
+
+void tim_wheel_x_cancel(
+	tim_wheel_handle_s *handle_ptr,
+	tim_wheel_tim_s *tim_ptr
+)
+{
+	assert(handle_ptr != NULL);
+	assert(tim_ptr != NULL);
+
+	if(tim_ptr->is_active) {
+		tim_wheel_x_unlink(handle_ptr, tim_ptr);
+	}
+}
+
+void tim_wheel_x_handler(tim_wheel_handle_s *handle_ptr)
+{
+	uint32_t now_ms;
+	uint32_t num_elapsed;
+
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->is_init);
+
+	now_ms = tim_wheel_x_now(handle_ptr);
+	num_elapsed = now_ms - handle_ptr->curr_ms;
+
+	if(handle_ptr->num_active == 0) {
+		handle_ptr->curr_ms = now_ms;
+		return;
+	}
+
+	// after a full round every slot is visited, the rest can not hold a new due timer
+	if(num_elapsed > TIM_WHEEL_NUM_SLOT) {
+		num_elapsed = TIM_WHEEL_NUM_SLOT;
+	}
+
+	for(uint32_t i = 1; i <= num_elapsed; ++i) {
+		tim_wheel_x_process_slot(
+			handle_ptr,
+			(handle_ptr->curr_ms + i) & TIM_WHEEL_SLOT_MASK,
+			now_ms
+		);
+	}
+	handle_ptr->curr_ms = now_ms;
+}
+
+bool tim_wheel_x_get_next_expiry(
+	const tim_wheel_handle_s *handle_ptr,
+	uint32_t *remaining_ms_ptr
+)
+{
+	uint32_t now_ms;
+	int32_t min_remaining = INT32_MAX;
+
+	assert(handle_ptr != NULL);
+	assert(remaining_ms_ptr != NULL);
+
+	if(handle_ptr->num_active == 0) {
+		return false;
+	}
+
+	now_ms = tim_wheel_x_now(handle_ptr);
+	for(uint32_t slot = 0; slot < TIM_WHEEL_NUM_SLOT; ++slot) {
+		for(tim_wheel_tim_s *tim_ptr = handle_ptr->slot_arr[slot]; tim_ptr != NULL; tim_ptr = tim_ptr->next_ptr) {
+			int32_t remaining = (int32_t)(tim_ptr->expiry_ms - now_ms);
+			if(remaining < min_remaining) {
+				min_remaining = remaining;
+			}
+		}
+	}
+
+	*remaining_ms_ptr = (min_remaining > 0) ? (uint32_t)min_remaining : 0;
+	return true;
+}
+
+void tim_wheel_init(void)
+{
+	tim_wheel_x_init(&_tim_wheel, &_tim_wheel_cfg);
+}
+
+void tim_wheel_start(
+	tim_wheel_tim_s *tim_ptr,
+	tim_wheel_cbk_t cbk_ptr,
+	void *arg_ptr,
+	uint32_t timeout_ms,
+	uint32_t period_ms
+)
+{
+	tim_wheel_x_start(&_tim_wheel, tim_ptr, cbk_ptr, arg_ptr, timeout_ms, period_ms);
+}
+
+void tim_wheel_cancel(tim_wheel_tim_s *tim_ptr)
+{
+	tim_wheel_x_cancel(&_tim_wheel, tim_ptr);
+}
+
+void tim_wheel_handler(void)
+{
+	tim_wheel_x_handler(&_tim_wheel);
+}
+
+bool tim_wheel_get_next_expiry(uint32_t *remaining_ms_ptr)
+{
+	return tim_wheel_x_get_next_expiry(&_tim_wheel, remaining_ms_ptr);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file tim_wheel.h
+ * @brief Hashed timer wheel on top of a 32-bit millisecond time (e.g. abs_tim_get_ms32).
+ * Timers are hashed by their expiry millisecond into TIM_WHEEL_NUM_SLOT slots.
+ * Start and cancel are O(1), the handler visits only the slots of the elapsed milliseconds.
+ * Callbacks run in the context of tim_wheel_x_handler(), which is called from the main loop.
+ *
+ * Timer objects are owned by the caller and linked into the wheel, no memory is allocated.
+ *
+ * @warning It is mandatory to create the following global variables in your application:
+ * tim_wheel_cfg_s _tim_wheel_cfg;
+ * tim_wheel_handle_s _tim_wheel;
+ */
+
+#ifndef TIM_WHEEL_H
+#define TIM_WHEEL_H
+
+#include "abs_tim.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef TIM_WHEEL_NUM_SLOT
+//! Number of slots, power of two. Timers further than this many milliseconds ahead stay for more rounds.
+#define TIM_WHEEL_NUM_SLOT 32u
+#endif
+
+typedef void (*tim_wheel_cbk_t)(void *arg_ptr);
+
+/**
+ * @brief Structure representing a timer.
+ * Fields are managed by the wheel, the timer has to stay valid while it is active.
+ */
+typedef struct tim_wheel_tim_s {
+	struct tim_wheel_tim_s *next_ptr; //!< next timer in the same slot
+	struct tim_wheel_tim_s *prev_ptr; //!< previous timer in the same slot, NULL if first
+	uint32_t expiry_ms; //!< 32-bit millisecond timestamp at which the timer expires
+	uint32_t period_ms; //!< reload period, 0 for a one shot timer
+	tim_wheel_cbk_t cbk_ptr; //!< called when the timer expires
+	void *arg_ptr; //!< argument of the callback
+	bool is_active; //!< true while linked into the wheel
+} tim_wheel_tim_s;
+
+/**
+ * @brief Configuration structure of the timer wheel.
+ */
+typedef struct {
+	abs_tim_u32_get_func_ptr_t get_ms_func_ptr; //!< 32-bit millisecond time base, wraps around, mandatory
+} tim_wheel_cfg_s;
+
+/**
+ * @brief Timer wheel handle structure.
+ */
+typedef struct {
+	tim_wheel_cfg_s *cfg_ptr;
+	tim_wheel_tim_s *slot_arr[TIM_WHEEL_NUM_SLOT]; //!< list heads, indexed by expiry_ms modulo TIM_WHEEL_NUM_SLOT
+	uint32_t curr_ms; //!< last millisecond processed by the handler
+	uint16_t num_active; //!< number of active timers
+	bool is_init;
+} tim_wheel_handle_s;
+
+void tim_wheel_x_init(
+	tim_wheel_handle_s *handle_ptr,
+	tim_wheel_cfg_s *cfg_ptr
+);
+
+/**
+ * @brief Start or restart a timer.
+ *
+ * @param handle_ptr Pointer to the timer wheel handle.
+ * @param tim_ptr Pointer to the timer, restarted if already active.
+ * @param cbk_ptr Called when the timer expires.
+ * @param arg_ptr Argument of the callback.
+ * @param timeout_ms Time until the first expiry.
+ * @param period_ms Reload period after expiry, 0 for a one shot timer.
+ */
+void tim_wheel_x_start(
+	tim_wheel_handle_s *handle_ptr,
+	tim_wheel_tim_s *tim_ptr,
+	tim_wheel_cbk_t cbk_ptr,
+	void *arg_ptr,
+	uint32_t timeout_ms,
+	uint32_t period_ms
+);
+
+//! Stop a timer, no effect if it is not active
+void tim_wheel_x_cancel(
+	tim_wheel_handle_s *handle_ptr,
+	tim_wheel_tim_s *tim_ptr
+);
+
+//! Run the callbacks of the expired timers
+void tim_wheel_x_handler(tim_wheel_handle_s *handle_ptr);
+
+/**
+ * @brief Get the time until the earliest expiry.
+ *
+ * @param handle_ptr Pointer to the timer wheel handle.
+ * @param remaining_ms_ptr Set to the milliseconds until the earliest expiry, 0 if already expired.
+ * @return false if there is no active timer.
+ */
+bool tim_wheel_x_get_next_expiry(
+	const tim_wheel_handle_s *handle_ptr,
+	uint32_t *remaining_ms_ptr
+);
+
+void tim_wheel_init(void);
+void tim_wheel_start(
+	tim_wheel_tim_s *tim_ptr,
+	tim_wheel_cbk_t cbk_ptr,
+	void *arg_ptr,
+	uint32_t timeout_ms,
+	uint32_t period_ms
+);
+void tim_wheel_cancel(tim_wheel_tim_s *tim_ptr);
+void tim_wheel_handler(void);
+bool tim_wheel_get_next_expiry(uint32_t *remaining_ms_ptr);
+
+extern tim_wheel_handle_s _tim_wheel;
+extern tim_wheel_cfg_s _tim_wheel_cfg;
+
+#endif // TIM_WHEEL_H
@@ -0,0 +1,61 @@
+#include "trace.h"
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TRACE_REC_MASK (TRACE_NUM_REC - 1u)
+
+void trace_x_init(
+	trace_handle_s *handle_ptr,
+	trace_cfg_s *cfg_ptr
+)
+{
+	assert(handle_ptr != NULL);
+	assert(cfg_ptr != NULL);
+	assert(cfg_ptr->get_ts_func_ptr != NULL);
+	assert((TRACE_NUM_REC & TRACE_REC_MASK) == 0); // power of two
+
+	(void)memset(handle_ptr, 0, sizeof(trace_handle_s));
+	handle_ptr->rec_size = sizeof(trace_rec_s);
+	handle_ptr->num_rec = TRACE_NUM_REC;
+	handle_ptr->cfg_ptr = cfg_ptr;
+	handle_ptr->magic = TRACE_MAGIC;
+}
+
+void trace_x_rec(
+	trace_handle_s *handle_ptr,
+	uint16_t id,
+	uint8_t num_arg,
+	uint32_t arg0,
+	uint32_t arg1,
+	uint32_t arg2
+)
+{
+	trace_rec_s *rec_ptr;
+
+	assert(handle_ptr != NULL);
+	assert(num_arg <= 3);
+
+	if((handle_ptr->magic != TRACE_MAGIC) || !handle_ptr->cfg_ptr->is_en) {
+		return;
+	}
+
+	rec_ptr = &handle_ptr->rec_arr[handle_ptr->num_written & TRACE_REC_MASK];
+	rec_ptr->ts = handle_ptr->cfg_ptr->get_ts_func_ptr();
+	rec_ptr->id = id;
+	rec_ptr->num_arg = num_arg;
+	rec_ptr->arg_arr[0] = arg0;
+	rec_ptr->arg_arr[1] = arg1;
+	rec_ptr->arg_arr[2] = arg2;
+	handle_ptr->num_written++;
+}
+
+void trace_init(void)
+{
+	trace_x_init(&_trace, &_trace_cfg);
+}
+
+void trace_rec(uint16_t id, uint8_t num_arg, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+	trace_x_rec(&_trace, id, num_arg, arg0, arg1, arg2);
+}
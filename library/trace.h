@@ -0,0 +1,121 @@
+/**
+ * @file trace.h
+ * @brief Binary trace log.
+ * Each trace point stores an event id, a timestamp and up to 3 arguments into a RAM ring.
+ * Nothing is formatted on target, the whole trace handle is read out as a memory blob
+ * (e.g. with RequestUpload) and decoded on the host with tools/trace_decode.py.
+ *
+ * Recording is meant for the main context, it is not protected against interrupts.
+ *
+ * @warning It is mandatory to create the following global variables in your application:
+ * trace_cfg_s _trace_cfg;
+ * trace_handle_s _trace;
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef TRACE_NUM_REC
+//! Number of records in the ring, power of two
+#define TRACE_NUM_REC 32u
+#endif
+
+//! Marks the start of a trace blob, "TRC1" in little endian memory order
+#define TRACE_MAGIC ((uint32_t)0x31435254)
+
+/**
+ * @brief Trace event ids known by the host decoder.
+ * Application specific ids start from TRACE_ID_USER.
+ */
+typedef enum {
+	TRACE_ID_NONE = 0,
+	TRACE_ID_DIAG_SESS, //!< arg0: new diagnostic session
+	TRACE_ID_SECURITY_LEVEL, //!< arg0: new security level
+	TRACE_ID_ECU_RESET, //!< arg0: reset type
+	TRACE_ID_BLOCK_RECV, //!< arg0: memory address, arg1: size, arg2: block sequence counter
+	TRACE_ID_PAGE_ERASED, //!< arg0: page index
+	TRACE_ID_PROG_ERR, //!< arg0: trace_prog_err_e, arg1: address or page index
+	TRACE_ID_USER = 0x80
+} trace_id_e;
+
+/**
+ * @brief Reasons of TRACE_ID_PROG_ERR.
+ */
+typedef enum {
+	TRACE_PROG_ERR_INVALID_DATA = 0,
+	TRACE_PROG_ERR_INVALID_ADDR,
+	TRACE_PROG_ERR_PAGE_OUT_OF_BOUNDS,
+	TRACE_PROG_ERR_FLASH_LOCKED,
+	TRACE_PROG_ERR_ERASE,
+	TRACE_PROG_ERR_WRITE
+} trace_prog_err_e;
+
+typedef uint32_t (*trace_get_ts_func_t)(void);
+
+/**
+ * @brief One trace record, 20 bytes.
+ */
+typedef struct {
+	uint32_t ts; //!< timestamp from get_ts_func_ptr
+	uint16_t id; //!< trace_id_e or user id
+	uint16_t num_arg; //!< number of valid arguments
+	uint32_t arg_arr[3];
+} trace_rec_s;
+
+/**
+ * @brief Configuration structure of the trace log.
+ */
+typedef struct {
+	trace_get_ts_func_t get_ts_func_ptr; //!< timestamp source, e.g. 32-bit milliseconds, mandatory
+	bool is_en; //!< recording can be switched off at runtime
+} trace_cfg_s;
+
+/**
+ * @brief Trace handle. The members up to rec_arr are the header read by the host decoder.
+ */
+typedef struct {
+	uint32_t magic; //!< TRACE_MAGIC once initialized
+	uint16_t rec_size; //!< sizeof(trace_rec_s)
+	uint16_t num_rec; //!< TRACE_NUM_REC
+	uint32_t num_written; //!< total number of records written, the newest one is at (num_written - 1) % num_rec
+	trace_rec_s rec_arr[TRACE_NUM_REC];
+	trace_cfg_s *cfg_ptr;
+} trace_handle_s;
+
+void trace_x_init(
+	trace_handle_s *handle_ptr,
+	trace_cfg_s *cfg_ptr
+);
+
+/**
+ * @brief Record a trace event, the oldest record is overwritten if the ring is full.
+ *
+ * @param handle_ptr Pointer to the trace handle.
+ * @param id Event id.
+ * @param num_arg Number of valid arguments, at most 3.
+ */
+void trace_x_rec(
+	trace_handle_s *handle_ptr,
+	uint16_t id,
+	uint8_t num_arg,
+	uint32_t arg0,
+	uint32_t arg1,
+	uint32_t arg2
+);
+
+void trace_init(void);
+void trace_rec(uint16_t id, uint8_t num_arg, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+//! Shorthands by number of arguments
+#define TRACE0(id) trace_rec((id), 0, 0, 0, 0)
+#define TRACE1(id, a0) trace_rec((id), 1, (uint32_t)(a0), 0, 0)
+#define TRACE2(id, a0, a1) trace_rec((id), 2, (uint32_t)(a0), (uint32_t)(a1), 0)
+#define TRACE3(id, a0, a1, a2) trace_rec((id), 3, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2))
+
+extern trace_handle_s _trace;
+extern trace_cfg_s _trace_cfg;
+
+#endif // TRACE_H
@@ -0,0 +1,420 @@
+#include "uds_ext.h"
+#include "uds_ext_internal.h"
+#include <assert.h>
+#include <string.h>
+
+//! P2* server max is given in 10 milliseconds units
+#define UDS_EXT_P2_STAR_RESOLUTION_MS 10u
+
+static void uds_ext_x_send(uds_ext_handle_s *handle_ptr, uint16_t size)
+{
+	uds_cfg_s *uds_cfg_ptr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr);
+
+	uds_cfg_ptr->iso_tp_send_func_ptr(
+		uds_cfg_ptr->iso_tp_handle_ptr,
+		handle_ptr->cfg_ptr->tx_ptr,
+		size
+	);
+}
+
+static abs_tim_handle_s *uds_ext_x_get_tim(uds_ext_handle_s *handle_ptr)
+{
+	return uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr)->abs_tim_handle_ptr;
+}
+
+/**
+ * Next response pending is due margin milliseconds before the given timeout.
+ * If the margin is bigger than the timeout, it is due immediately.
+ */
+static void uds_ext_x_set_resp_deadline(uds_ext_handle_s *handle_ptr, uint32_t timeout_ms)
+{
+	uint16_t margin_ms = handle_ptr->cfg_ptr->resp_pending_margin_ms;
+
+	handle_ptr->resp_deadline_ms = (uint32_t)abs_tim_x_get(uds_ext_x_get_tim(handle_ptr));
+	if(timeout_ms > margin_ms) {
+		handle_ptr->resp_deadline_ms += timeout_ms - margin_ms;
+	}
+}
+
+/**
+ * Negative response which does not touch tx_ptr,
+ * a deferred request may be building its final response there.
+ */
+static void uds_ext_x_async_neg_resp(uds_ext_handle_s *handle_ptr, uint8_t sid, uint8_t nrc)
+{
+	uds_cfg_s *uds_cfg_ptr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr);
+
+	handle_ptr->async_nrc_arr[0] = UDS_EXT_NEG_RESP_SID;
+	handle_ptr->async_nrc_arr[1] = sid;
+	handle_ptr->async_nrc_arr[2] = nrc;
+	uds_cfg_ptr->iso_tp_send_func_ptr(
+		uds_cfg_ptr->iso_tp_handle_ptr,
+		handle_ptr->async_nrc_arr,
+		sizeof(handle_ptr->async_nrc_arr)
+	);
+}
+
+static void uds_ext_x_resp_pending(uds_ext_handle_s *handle_ptr)
+{
+	uds_cfg_s *uds_cfg_ptr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr);
+
+	// wrap safe 32-bit compare, deadlines are at most P2* ahead
+	if((int32_t)((uint32_t)abs_tim_x_get(uds_cfg_ptr->abs_tim_handle_ptr) - handle_ptr->resp_deadline_ms) < 0) {
+		return;
+	}
+
+	uds_ext_x_async_neg_resp(handle_ptr, handle_ptr->req_sid, UDS_EXT_NRC_RESP_PENDING);
+	handle_ptr->resp_pending_cnt++;
+
+	// client waits P2* after each response pending
+	uds_ext_x_set_resp_deadline(
+		handle_ptr,
+		(uint32_t)uds_cfg_ptr->p2_star_server_max * UDS_EXT_P2_STAR_RESOLUTION_MS
+	);
+}
+
+void uds_ext_x_neg_resp(uds_ext_handle_s *handle_ptr, uint8_t sid, uint8_t nrc)
+{
+	uint8_t *tx_ptr = handle_ptr->cfg_ptr->tx_ptr;
+
+	tx_ptr[0] = UDS_EXT_NEG_RESP_SID;
+	tx_ptr[1] = sid;
+	tx_ptr[2] = nrc;
+	uds_ext_x_send(handle_ptr, 3);
+}
+
+/**
+ * The session list of the core is only scanned when the session has changed,
+ * afterwards the session check is a single AND.
+ */
+static uint32_t uds_ext_x_get_diag_sess_bit(uds_ext_handle_s *handle_ptr)
+{
+	uds_cfg_s *uds_cfg_ptr;
+	uint8_t diag_sess = uds_x_get_diag_sess(handle_ptr->uds_handle_ptr);
+
+	if(diag_sess == handle_ptr->diag_sess_cache) {
+		return handle_ptr->diag_sess_bit;
+	}
+
+	uds_cfg_ptr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr);
+	handle_ptr->diag_sess_cache = diag_sess;
+	handle_ptr->diag_sess_bit = 0;
+	for(int8_t i = 0; i < uds_cfg_ptr->num_avail_diag_sess; ++i) {
+		if(uds_cfg_ptr->avail_diag_sess_ptr[i].diag_sess == diag_sess) {
+			handle_ptr->diag_sess_bit = UDS_EXT_DIAG_SESS_BIT(i);
+			break;
+		}
+	}
+	return handle_ptr->diag_sess_bit;
+}
+
+bool uds_ext_x_check_allowed(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t sid,
+	const uds_ext_access_s *access_ptr
+)
+{
+	uint8_t security_level = uds_x_get_security_level(handle_ptr->uds_handle_ptr);
+
+	assert(access_ptr != NULL);
+
+	if((access_ptr->security_level_mask & UDS_EXT_SEC_LEVEL_BIT(security_level)) == 0) {
+		uds_ext_x_neg_resp(handle_ptr, sid, UDS_EXT_NRC_SECURITY_ACCESS_DENIED);
+		return false;
+	}
+
+	if((access_ptr->diag_sess_mask & uds_ext_x_get_diag_sess_bit(handle_ptr)) == 0) {
+		uds_ext_x_neg_resp(handle_ptr, sid, UDS_EXT_NRC_SERV_NOT_SUPP_IN_SESS);
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t uds_ext_get_be(const uint8_t *data_ptr, uint8_t len)
+{
+	uint32_t val = 0;
+
+	for(uint8_t i = 0; i < len; ++i) {
+		val = (val << 8) | data_ptr[i];
+	}
+	return val;
+}
+
+void uds_ext_put_be(uint8_t *data_ptr, uint32_t val, uint8_t len)
+{
+	for(uint8_t i = len; i > 0; --i) {
+		data_ptr[i - 1u] = (uint8_t)val;
+		val >>= 8;
+	}
+}
+
+void uds_ext_x_register_serv(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t sid,
+	uds_ext_serv_func_t func_ptr
+)
+{
+	assert(func_ptr != NULL);
+	assert(handle_ptr->serv_idx_arr[sid] == UDS_EXT_SERV_IDX_NONE); // registered twice
+	assert(handle_ptr->num_serv < UDS_EXT_MAX_SERV); // increase UDS_EXT_MAX_SERV
+
+	handle_ptr->serv_idx_arr[sid] = handle_ptr->num_serv;
+	handle_ptr->serv_func_arr[handle_ptr->num_serv] = func_ptr;
+	handle_ptr->num_serv++;
+	uds_ext_x_set_serv_en(handle_ptr, sid, true);
+}
+
+void uds_ext_x_init(
+	uds_ext_handle_s *handle_ptr,
+	const uds_ext_cfg_s *cfg_ptr,
+	uds_handle_s *uds_handle_ptr
+)
+{
+	assert(handle_ptr != NULL);
+	assert(cfg_ptr != NULL);
+	assert(uds_handle_ptr != NULL);
+	assert(uds_handle_ptr->is_init);
+	assert(cfg_ptr->tx_ptr != NULL);
+	assert(cfg_ptr->tx_buf_size >= 4);
+
+	assert((cfg_ptr->num_serv <= 0) || (cfg_ptr->serv_ptr != NULL));
+	assert(!cfg_ptr->is_serv_en.ctrl_dtc_setting || cfg_ptr->is_serv_en.dtc);
+	assert(uds_x_get_cfg_ptr(uds_handle_ptr)->num_avail_diag_sess <= UDS_EXT_MAX_DIAG_SESS);
+
+	(void)memset(handle_ptr, 0, sizeof(uds_ext_handle_s));
+	(void)memset(handle_ptr->serv_idx_arr, UDS_EXT_SERV_IDX_NONE, sizeof(handle_ptr->serv_idx_arr));
+	handle_ptr->cfg_ptr = cfg_ptr;
+	handle_ptr->uds_handle_ptr = uds_handle_ptr;
+
+	if(cfg_ptr->is_serv_en.req_upload) {
+		uds_ext_x_upload_init(handle_ptr);
+	}
+	if(cfg_ptr->is_serv_en.dtc) {
+		uds_ext_x_dtc_init(handle_ptr);
+	}
+	uds_ext_x_comm_init(handle_ptr);
+	if(cfg_ptr->is_serv_en.link_ctrl) {
+		uds_ext_x_link_init(handle_ptr);
+	}
+	if(cfg_ptr->is_serv_en.io_ctrl) {
+		uds_ext_x_io_init(handle_ptr);
+	}
+
+	// user services, after the built in ones so a duplicate sid asserts
+	for(int16_t i = 0; i < cfg_ptr->num_serv; ++i) {
+		uds_ext_x_register_serv(handle_ptr, cfg_ptr->serv_ptr[i].sid, cfg_ptr->serv_ptr[i].func_ptr);
+	}
+
+	handle_ptr->is_init = true;
+}
+
+bool uds_ext_x_put_packet_in(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->is_init);
+	assert(data_ptr != NULL);
+
+	if(data_size == 0) {
+		return false;
+	}
+
+	if(handle_ptr->deferred_func_ptr != NULL) {
+		if(data_ptr[0] == UDS_EXT_SID_TESTER_PRESENT) {
+			// keeps S3 running during a long job, the open request is left as it is
+			return false;
+		}
+		// only one request at a time, the deferred one is still being processed
+		uds_ext_x_async_neg_resp(handle_ptr, data_ptr[0], UDS_EXT_NRC_BUSY_REPEAT_REQ);
+		return true;
+	}
+
+	handle_ptr->is_req_open = true;
+	handle_ptr->req_sid = data_ptr[0];
+	handle_ptr->resp_pending_cnt = 0;
+	uds_ext_x_set_resp_deadline(
+		handle_ptr,
+		uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr)->p2_server_max
+	);
+
+	if(!uds_ext_x_is_serv_en(handle_ptr, data_ptr[0])) {
+		return false; // core serves it or responds with service not supported
+	}
+
+	if(!handle_ptr->serv_func_arr[handle_ptr->serv_idx_arr[data_ptr[0]]](handle_ptr, data_ptr, data_size)) {
+		return false; // service passed it on to the core
+	}
+
+	// answered right away unless the service deferred the response
+	handle_ptr->is_req_open = (handle_ptr->deferred_func_ptr != NULL);
+	return true;
+}
+
+void uds_ext_x_handler(uds_ext_handle_s *handle_ptr)
+{
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->is_init);
+
+	if(handle_ptr->cfg_ptr->is_serv_en.link_ctrl) {
+		uds_ext_x_link_handler(handle_ptr);
+	}
+	if(handle_ptr->cfg_ptr->is_serv_en.io_ctrl) {
+		uds_ext_x_io_handler(handle_ptr);
+	}
+	if(handle_ptr->deferred_func_ptr == NULL) {
+		// requests served by the core are answered in uds_handler
+		handle_ptr->is_req_open = false;
+		return;
+	}
+
+	if(handle_ptr->deferred_func_ptr(handle_ptr, handle_ptr->deferred_arg_ptr) == UDS_EXT_RESP_DONE) {
+		handle_ptr->deferred_func_ptr = NULL;
+		handle_ptr->deferred_arg_ptr = NULL;
+		handle_ptr->is_req_open = false;
+	} else {
+		uds_ext_x_resp_pending(handle_ptr);
+	}
+}
+
+void uds_ext_x_defer(
+	uds_ext_handle_s *handle_ptr,
+	uds_ext_deferred_func_t func_ptr,
+	void *arg_ptr
+)
+{
+	assert(handle_ptr != NULL);
+	assert(func_ptr != NULL);
+	assert(handle_ptr->is_req_open);
+
+	handle_ptr->deferred_func_ptr = func_ptr;
+	handle_ptr->deferred_arg_ptr = arg_ptr;
+}
+
+void uds_ext_x_keep_alive(uds_ext_handle_s *handle_ptr)
+{
+	assert(handle_ptr != NULL);
+
+	if(handle_ptr->is_req_open) {
+		uds_ext_x_resp_pending(handle_ptr);
+	}
+}
+
+void uds_ext_x_set_serv_en(uds_ext_handle_s *handle_ptr, uint8_t sid, bool is_en)
+{
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->serv_idx_arr[sid] != UDS_EXT_SERV_IDX_NONE);
+
+	if(is_en) {
+		handle_ptr->serv_en_bitmap[sid >> 5] |= (1UL << (sid & 0x1F));
+	} else {
+		handle_ptr->serv_en_bitmap[sid >> 5] &= ~(1UL << (sid & 0x1F));
+	}
+}
+
+bool uds_ext_x_is_serv_en(const uds_ext_handle_s *handle_ptr, uint8_t sid)
+{
+	assert(handle_ptr != NULL);
+
+	return (handle_ptr->serv_en_bitmap[sid >> 5] & (1UL << (sid & 0x1F))) != 0;
+}
+
+void uds_ext_x_send_resp(uds_ext_handle_s *handle_ptr, uint16_t size)
+{
+	assert(handle_ptr != NULL);
+	assert(size <= handle_ptr->cfg_ptr->tx_buf_size);
+
+	uds_ext_x_send(handle_ptr, size);
+}
+
+void uds_ext_x_abort(uds_ext_handle_s *handle_ptr, uint8_t new_sess)
+{
+	assert(handle_ptr != NULL);
+
+	if(handle_ptr->cfg_ptr->is_serv_en.req_upload) {
+		uds_ext_x_upload_abort(handle_ptr);
+	}
+	if(handle_ptr->cfg_ptr->is_serv_en.dtc) {
+		uds_ext_x_dtc_abort(handle_ptr, new_sess);
+	}
+	if(handle_ptr->cfg_ptr->is_serv_en.comm_ctrl) {
+		uds_ext_x_comm_abort(handle_ptr, new_sess);
+	}
+	if(handle_ptr->cfg_ptr->is_serv_en.link_ctrl) {
+		uds_ext_x_link_abort(handle_ptr);
+	}
+	if(handle_ptr->cfg_ptr->is_serv_en.io_ctrl) {
+		uds_ext_x_io_abort(handle_ptr);
+	}
+	handle_ptr->deferred_func_ptr = NULL;
+	handle_ptr->deferred_arg_ptr = NULL;
+	handle_ptr->is_req_open = false;
+}
+
+void uds_ext_init(void)
+{
+	uds_ext_x_init(&_uds_ext_handle, &_uds_ext_cfg, &_uds_handle);
+}
+
+bool uds_ext_put_packet_in(uint8_t *data_ptr, uint16_t data_size)
+{
+	return uds_ext_x_put_packet_in(&_uds_ext_handle, data_ptr, data_size);
+}
+
+void uds_ext_handler(void)
+{
+	uds_ext_x_handler(&_uds_ext_handle);
+}
+
+void uds_ext_defer(uds_ext_deferred_func_t func_ptr, void *arg_ptr)
+{
+	uds_ext_x_defer(&_uds_ext_handle, func_ptr, arg_ptr);
+}
+
+void uds_ext_keep_alive(void)
+{
+	uds_ext_x_keep_alive(&_uds_ext_handle);
+}
+
+void uds_ext_abort(uint8_t new_sess)
+{
+	uds_ext_x_abort(&_uds_ext_handle, new_sess);
+}
+
+int32_t uds_ext_find_dtc(uint32_t dtc_id)
+{
+	return uds_ext_x_find_dtc(&_uds_ext_handle, dtc_id);
+}
+
+void uds_ext_set_dtc_st(uint16_t dtc_idx, bool is_failed)
+{
+	uds_ext_x_set_dtc_st(&_uds_ext_handle, dtc_idx, is_failed);
+}
+
+void uds_ext_end_dtc_op_cycle(void)
+{
+	uds_ext_x_end_dtc_op_cycle(&_uds_ext_handle);
+}
+
+uint8_t uds_ext_get_dtc_st(uint16_t dtc_idx)
+{
+	return uds_ext_x_get_dtc_st(&_uds_ext_handle, dtc_idx);
+}
+
+bool uds_ext_is_comm_tx_en(uint8_t comm_type)
+{
+	return uds_ext_x_is_comm_tx_en(&_uds_ext_handle, comm_type);
+}
+
+bool uds_ext_is_comm_rx_en(uint8_t comm_type)
+{
+	return uds_ext_x_is_comm_rx_en(&_uds_ext_handle, comm_type);
+}
+
+const uint8_t *uds_ext_get_io_ctrl(uint8_t sig_idx)
+{
+	return uds_ext_x_get_io_ctrl(&_uds_ext_handle, sig_idx);
+}
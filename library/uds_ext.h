@@ -0,0 +1,728 @@
+/**
+ * @file uds_ext.h
+ * @brief UDS extension services header file
+ * This file contains the definitions and structures of the services that are
+ * built on top of the core UDS implementation (uds.h).
+ *
+ * Every received packet is offered to this module first. If the packet belongs
+ * to an extension service it is consumed here, otherwise it has to be handed
+ * to the core UDS implementation as usual:
+ *
+ *    if(!uds_ext_put_packet_in(payload_arr, out_size)) {
+ *        uds_put_packet_in(payload_arr, out_size);
+ *    }
+ *
+ * Services are dispatched in constant time through a SID indexed table.
+ * Besides the built-in extension services, applications can register their own
+ * (e.g. OEM specific) services through serv_ptr of the extension configuration.
+ *
+ * Responses are sent with the ISO-TP send function of the core UDS configuration.
+ *
+ * uds_ext_handler() has to be called right after uds_handler() in the main loop.
+ * It drives the deferred responses and the automatic response pending (NRC 0x78) messages.
+ * The extension timeouts (response pending, IO control, DTC time debounce) are polled in the
+ * handlers against the abs_tim of the core configuration, like the core UDS timeouts.
+ * They do not need a timer wheel, the application only has to call the handlers periodically.
+ *
+ * The extension configuration is read only, it can be declared const and placed in flash.
+ * All runtime state is kept in the extension handle and in the RAM arrays the configuration
+ * points to (e.g. the DTC store).
+ *
+ * @warning It is mandatory to create the following global variables in your application:
+ * const uds_ext_cfg_s _uds_ext_cfg;
+ * uds_ext_handle_s _uds_ext_handle;
+ */
+
+#ifndef UDS_EXT_H
+#define UDS_EXT_H
+
+#include "uds.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Service identifiers handled by the extension module
+#define UDS_EXT_SID_CLEAR_DIAG_INFO ((uint8_t)0x14) //!< Clear diagnostic information
+#define UDS_EXT_SID_READ_DTC_INFO ((uint8_t)0x19) //!< Read DTC information
+#define UDS_EXT_SID_COMM_CTRL ((uint8_t)0x28) //!< Communication control
+#define UDS_EXT_SID_IO_CTRL_BY_ID ((uint8_t)0x2F) //!< Input output control by identifier
+#define UDS_EXT_SID_ROUTINE_DOWNLOAD ((uint8_t)0x34) //!< Request download
+#define UDS_EXT_SID_REQ_UPLOAD ((uint8_t)0x35) //!< Request upload
+#define UDS_EXT_SID_TRANSFER_DATA ((uint8_t)0x36) //!< Transfer data
+#define UDS_EXT_SID_REQ_TRANSFER_EXIT ((uint8_t)0x37) //!< Request transfer exit
+#define UDS_EXT_SID_TESTER_PRESENT ((uint8_t)0x3E) //!< Tester present, always served by the core
+#define UDS_EXT_SID_CTRL_DTC_SETTING ((uint8_t)0x85) //!< Control DTC setting
+#define UDS_EXT_SID_LINK_CTRL ((uint8_t)0x87) //!< Link control
+
+//! suppressPosRspMsgIndicationBit of a sub-function
+#define UDS_EXT_SUPPRESS_POS_RESP ((uint8_t)0x80)
+//! sub-function without suppressPosRspMsgIndicationBit
+#define UDS_EXT_SUB_FUNC_MASK ((uint8_t)0x7F)
+
+//! Number of possible service identifiers
+#define UDS_EXT_NUM_SID 256
+//! Index of a service identifier which has no handler in the dispatch table
+#define UDS_EXT_SERV_IDX_NONE ((uint8_t)0xFF)
+
+#ifndef UDS_EXT_MAX_SERV
+//! Maximum number of services in the dispatch table, built-in and user services together
+#define UDS_EXT_MAX_SERV 16
+#endif
+
+/**
+ * Diagnostic session bit of an access mask.
+ * idx is the position of the session in avail_diag_sess_ptr of the core UDS configuration.
+ */
+#define UDS_EXT_DIAG_SESS_BIT(idx) ((uint32_t)1 << (idx))
+//! Allowed in every available diagnostic session
+#define UDS_EXT_DIAG_SESS_ALL ((uint32_t)0xFFFFFFFF)
+//! Maximum number of available diagnostic sessions representable in an access mask
+#define UDS_EXT_MAX_DIAG_SESS 32
+
+/**
+ * Security level bit of an access mask.
+ * Security levels above 31 share bit 31.
+ */
+#define UDS_EXT_SEC_LEVEL_BIT(level) ((uint32_t)1 << (((level) < 31u) ? (level) : 31u))
+//! Allowed in the given and all higher security levels, same as req_security_level of the core
+#define UDS_EXT_SEC_LEVEL_MIN(level) ((uint32_t)0xFFFFFFFF << (((level) < 31u) ? (level) : 31u))
+
+//! Negative response codes for extension and user services
+#define UDS_EXT_NRC_SERV_NOT_SUPP ((uint8_t)0x11)
+#define UDS_EXT_NRC_SUB_FUNC_NOT_SUPP ((uint8_t)0x12)
+#define UDS_EXT_NRC_INCORRECT_MSG_LEN ((uint8_t)0x13)
+#define UDS_EXT_NRC_RESP_TOO_LONG ((uint8_t)0x14)
+#define UDS_EXT_NRC_BUSY_REPEAT_REQ ((uint8_t)0x21)
+#define UDS_EXT_NRC_CONDITIONS_NOT_CORRECT ((uint8_t)0x22)
+#define UDS_EXT_NRC_REQ_SEQ_ERR ((uint8_t)0x24)
+#define UDS_EXT_NRC_REQ_OUT_OF_RANGE ((uint8_t)0x31)
+#define UDS_EXT_NRC_SECURITY_ACCESS_DENIED ((uint8_t)0x33)
+#define UDS_EXT_NRC_WRONG_BSC ((uint8_t)0x73)
+#define UDS_EXT_NRC_RESP_PENDING ((uint8_t)0x78)
+#define UDS_EXT_NRC_SUB_FUNC_NOT_SUPP_IN_SESS ((uint8_t)0x7E)
+#define UDS_EXT_NRC_SERV_NOT_SUPP_IN_SESS ((uint8_t)0x7F)
+
+#define UDS_EXT_NEG_RESP_SID ((uint8_t)0x7F) //!< SID of a negative response
+#define UDS_EXT_POS_RESP_OFFSET ((uint8_t)0x40) //!< added to the request SID in a positive response
+
+//! Read DTC information sub-functions served by the DTC store
+#define UDS_EXT_DTC_REPORT_NUM_BY_ST_MASK ((uint8_t)0x01)
+#define UDS_EXT_DTC_REPORT_BY_ST_MASK ((uint8_t)0x02)
+#define UDS_EXT_DTC_REPORT_SNAP_BY_DTC ((uint8_t)0x04)
+#define UDS_EXT_DTC_REPORT_EXT_DATA_BY_DTC ((uint8_t)0x06)
+//! DTCFormatIdentifier of ISO 14229-1 DTCs
+#define UDS_EXT_DTC_FORMAT_ISO14229 ((uint8_t)0x01)
+
+//! Communication control sub-functions, controlType
+#define UDS_EXT_COMM_CTRL_EN_RX_TX ((uint8_t)0x00) //!< enableRxAndTx
+#define UDS_EXT_COMM_CTRL_EN_RX_DIS_TX ((uint8_t)0x01) //!< enableRxAndDisableTx
+#define UDS_EXT_COMM_CTRL_DIS_RX_EN_TX ((uint8_t)0x02) //!< disableRxAndEnableTx
+#define UDS_EXT_COMM_CTRL_DIS_RX_TX ((uint8_t)0x03) //!< disableRxAndTx
+//! Communication types, bits of communicationType
+#define UDS_EXT_COMM_TYPE_NORMAL ((uint8_t)0x01) //!< normal communication messages
+#define UDS_EXT_COMM_TYPE_NM ((uint8_t)0x02) //!< network management communication messages
+#define UDS_EXT_COMM_TYPE_ALL (UDS_EXT_COMM_TYPE_NORMAL | UDS_EXT_COMM_TYPE_NM)
+
+//! Input output control parameters, inputOutputControlParameter
+#define UDS_EXT_IO_CTRL_RETURN_TO_ECU ((uint8_t)0x00) //!< returnControlToECU
+#define UDS_EXT_IO_CTRL_FREEZE ((uint8_t)0x02) //!< freezeCurrentState
+#define UDS_EXT_IO_CTRL_SHORT_TERM_ADJ ((uint8_t)0x03) //!< shortTermAdjustment
+
+#ifndef UDS_EXT_IO_CTRL_MAX_SIZE
+//! Maximum size of the controlState of an input output signal in bytes
+#define UDS_EXT_IO_CTRL_MAX_SIZE 4
+#endif
+
+//! Link control sub-functions, linkControlType
+#define UDS_EXT_LINK_CTRL_VERIFY_FIXED ((uint8_t)0x01) //!< verifyModeTransitionWithFixedParameter
+#define UDS_EXT_LINK_CTRL_VERIFY_SPECIFIC ((uint8_t)0x02) //!< verifyModeTransitionWithSpecificParameter
+#define UDS_EXT_LINK_CTRL_TRANSITION ((uint8_t)0x03) //!< transitionMode
+
+//! Control DTC setting sub-functions
+#define UDS_EXT_DTC_SETTING_ON ((uint8_t)0x01)
+#define UDS_EXT_DTC_SETTING_OFF ((uint8_t)0x02)
+
+//! DTC status bits
+#define UDS_EXT_DTC_ST_TF ((uint8_t)0x01) //!< testFailed
+#define UDS_EXT_DTC_ST_TFTOC ((uint8_t)0x02) //!< testFailedThisOperationCycle
+#define UDS_EXT_DTC_ST_PDTC ((uint8_t)0x04) //!< pendingDTC
+#define UDS_EXT_DTC_ST_CDTC ((uint8_t)0x08) //!< confirmedDTC
+#define UDS_EXT_DTC_ST_TNCSLC ((uint8_t)0x10) //!< testNotCompletedSinceLastClear
+#define UDS_EXT_DTC_ST_TFSLC ((uint8_t)0x20) //!< testFailedSinceLastClear
+#define UDS_EXT_DTC_ST_TNCTOC ((uint8_t)0x40) //!< testNotCompletedThisOperationCycle
+#define UDS_EXT_DTC_ST_WIR ((uint8_t)0x80) //!< warningIndicatorRequested
+//! Number of DTC status bits, one bitset each
+#define UDS_EXT_DTC_NUM_ST_BIT 8u
+//! Status bits kept over power cycles, written to NVM when they change
+#define UDS_EXT_DTC_ST_NVM_MASK (UDS_EXT_DTC_ST_PDTC | UDS_EXT_DTC_ST_CDTC | UDS_EXT_DTC_ST_TNCSLC | UDS_EXT_DTC_ST_TFSLC)
+//! Status of a DTC after clear
+#define UDS_EXT_DTC_ST_CLEARED (UDS_EXT_DTC_ST_TNCSLC | UDS_EXT_DTC_ST_TNCTOC)
+//! groupOfDTC of all DTCs
+#define UDS_EXT_DTC_GROUP_ALL ((uint32_t)0xFFFFFF)
+
+/// Size of the NVM record of a DTC: status byte, failed operation cycle counter, aging counter,
+/// occurrence counter, first and last seen timestamps (4 bytes each, big endian)
+#define UDS_EXT_DTC_NVM_REC_SIZE 12u
+
+//! DTCExtDataRecordNumbers of ReportDTCExtDataRecordByDTCNumber
+#define UDS_EXT_DTC_EXT_REC_OCC ((uint8_t)0x01) //!< occurrence counter, 1 byte
+#define UDS_EXT_DTC_EXT_REC_AGING ((uint8_t)0x02) //!< aging counter, 1 byte
+/// First and last seen records hold the seconds since power-on of the operation cycle in which
+/// the occurrence happened. abs_tim restarts at every reset, so values of different cycles
+/// cannot be compared.
+#define UDS_EXT_DTC_EXT_REC_FIRST_SEEN ((uint8_t)0x03) //!< first occurrence since clear, seconds since power-on of its cycle, 4 bytes
+#define UDS_EXT_DTC_EXT_REC_LAST_SEEN ((uint8_t)0x04) //!< most recent occurrence, seconds since power-on of its cycle, 4 bytes
+#define UDS_EXT_DTC_EXT_REC_ALL ((uint8_t)0xFF)
+
+#ifndef UDS_EXT_DTC_SNAP_DATA_SIZE
+//! Size of the data of a snapshot record, it has to hold the DID values of the largest snapshot
+#define UDS_EXT_DTC_SNAP_DATA_SIZE 8u
+#endif
+//! DTCSnapshotRecordNumber of the first occurrence since the last clear
+#define UDS_EXT_DTC_SNAP_REC_FIRST ((uint8_t)0x01)
+//! DTCSnapshotRecordNumber of the most recent occurrence
+#define UDS_EXT_DTC_SNAP_REC_LAST ((uint8_t)0x02)
+//! DTCSnapshotRecordNumber requesting all records
+#define UDS_EXT_DTC_SNAP_REC_ALL ((uint8_t)0xFF)
+//! DTC index of a free snapshot slot
+#define UDS_EXT_DTC_SNAP_FREE ((uint16_t)0xFFFF)
+
+//! Number of 32-bit words of a bitset with one bit per DTC
+#define UDS_EXT_DTC_NUM_WORD(num_dtc) (((num_dtc) + 31u) / 32u)
+//! Size of st_bit_arr of the DTC store in 32-bit words
+#define UDS_EXT_DTC_ST_BIT_ARR_SIZE(num_dtc) (UDS_EXT_DTC_NUM_ST_BIT * UDS_EXT_DTC_NUM_WORD(num_dtc))
+
+/**
+ * @brief Result of a deferred request processing function.
+ */
+typedef enum {
+	UDS_EXT_RESP_DONE = 0, //!< final response is sent, request is completed
+	UDS_EXT_RESP_PENDING //!< still busy, function is going to be called again in the next handler call
+} uds_ext_resp_e;
+
+/**
+ * @brief The function type for processing a deferred request.
+ * Called from uds_ext_x_handler until it returns UDS_EXT_RESP_DONE.
+ * Response pending messages are sent automatically while it returns UDS_EXT_RESP_PENDING.
+ * @param handle_ptr Pointer to the extension handle, to be used for sending the final response.
+ * @param arg_ptr User argument given to uds_ext_x_defer.
+ * @return UDS_EXT_RESP_DONE if the final response is sent, UDS_EXT_RESP_PENDING otherwise.
+ */
+typedef uds_ext_resp_e (*uds_ext_deferred_func_t)(void *handle_ptr, void *arg_ptr);
+
+/**
+ * @brief The function type for an extension or user service.
+ * Called with the whole request, data_ptr[0] is the SID.
+ * The service either sends its response with uds_ext_x_send_resp / uds_ext_x_neg_resp,
+ * or defers it with uds_ext_x_defer.
+ * @param handle_ptr Pointer to the extension handle.
+ * @param data_ptr Pointer to the request.
+ * @param data_size Size of the request.
+ * @return true if the request is consumed,
+ * false if it has to be handed to the core UDS implementation.
+ */
+typedef bool (*uds_ext_serv_func_t)(void *handle_ptr, uint8_t *data_ptr, uint16_t data_size);
+
+/**
+ * @brief Structure representing a service in the dispatch table.
+ */
+typedef struct {
+	uint8_t sid; //!< service identifier of the request
+	uds_ext_serv_func_t func_ptr; //!< service function, mandatory
+} uds_ext_serv_s;
+
+/**
+ * @brief Structure representing a memory region.
+ * Memory regions are memory mapped, data is read directly from the given address.
+ */
+typedef struct {
+	uint32_t addr; //!< start address of the region
+	uint32_t size; //!< size of the region in bytes
+} uds_ext_mem_region_s;
+
+/**
+ * @brief Structure representing the access rights of an extension or user service.
+ * Checked with a single AND each, see UDS_EXT_DIAG_SESS_BIT and UDS_EXT_SEC_LEVEL_BIT.
+ */
+typedef struct {
+	uint32_t diag_sess_mask; //!< allowed diagnostic sessions, one bit per available diagnostic session
+	uint32_t security_level_mask; //!< allowed security levels, one bit per security level
+} uds_ext_access_s;
+
+/**
+ * @brief Structure representing a request upload configuration.
+ * The client is allowed to upload any range that lies completely inside one of the regions.
+ */
+typedef struct {
+	const uds_ext_mem_region_s *region_ptr; //!< pointer to the regions allowed to be uploaded, mandatory
+	int8_t num_region; //!< number of regions allowed to be uploaded
+	/// maxNumberOfBlockLength reported to the client, including SID and block sequence counter.
+	/// Limited by tx_buf_size of the extension configuration.
+	uint16_t block_size;
+	uds_ext_access_s access; //!< allowed diagnostic sessions and security levels for this request upload
+} uds_ext_upload_s;
+
+/**
+ * @brief The callback function type for control DTC setting changes.
+ * @param is_on false while DTC status updates are suppressed.
+ */
+typedef void (*uds_ext_dtc_setting_cbk_t)(bool is_on);
+
+/**
+ * @brief Debounce type of a DTC.
+ */
+typedef enum {
+	UDS_EXT_DTC_DEB_NONE = 0, //!< every reported result is qualified
+	UDS_EXT_DTC_DEB_CNT, //!< counter based, failed results count up, passed results count down
+	UDS_EXT_DTC_DEB_TIME //!< time based, a result is qualified when it has been reported for long enough
+} uds_ext_dtc_deb_type_e;
+
+/**
+ * @brief Debounce, confirmation and aging parameters of a DTC, see ISO 14229-1 Annex D.
+ */
+typedef struct {
+	uds_ext_dtc_deb_type_e type; //!< debounce type
+	uint8_t inc_step; //!< counter based, added per failed result
+	uint8_t dec_step; //!< counter based, subtracted per passed result
+	/// counter based: counter value at which the test fails, at most INT16_MAX.
+	/// Time based: milliseconds the failed result has to be reported for.
+	uint16_t fail_thr;
+	/// counter based: negated counter value at which the test passes, at most INT16_MAX.
+	/// Time based: milliseconds the passed result has to be reported for.
+	uint16_t pass_thr;
+	/// failed operation cycles in a row until confirmedDTC is set, 0 and 1 confirm at the first failure
+	uint8_t confirm_thr;
+	/// operation cycles passed without failure until confirmedDTC is cleared, 0 never ages
+	uint8_t aging_thr;
+} uds_ext_dtc_deb_cfg_s;
+
+/**
+ * @brief RAM debounce, operation cycle and extended data state of a DTC.
+ */
+typedef struct {
+	int16_t cnt; //!< counter based: debounce counter. Time based: sign of the result since since_ms
+	uint32_t since_ms; //!< time based, timestamp of the first report of the current result, wraps around
+	uint8_t fail_cycle_cnt; //!< failed operation cycles in a row while not confirmed, kept in NVM
+	uint8_t aging_cnt; //!< operation cycles passed without failure while confirmed, kept in NVM
+	uint8_t occ_cnt; //!< occurrences since the last clear, saturates at 255, kept in NVM
+	uint32_t first_seen_s; //!< seconds since power-on of the first occurrence since the last clear, kept in NVM
+	uint32_t last_seen_s; //!< seconds since power-on of the most recent occurrence, kept in NVM
+} uds_ext_dtc_deb_s;
+
+/**
+ * @brief Snapshot (freeze frame) description of a DTC.
+ */
+typedef struct {
+	const uint16_t *did_idx_arr; //!< indexes into the DID list of the core UDS configuration
+	uint8_t num_did; //!< number of DIDs, their buffers together fit in UDS_EXT_DTC_SNAP_DATA_SIZE
+} uds_ext_dtc_snap_cfg_s;
+
+/**
+ * @brief Snapshot slot of the snapshot ring, kept in RAM and copied as is to NVM.
+ */
+typedef struct {
+	uint16_t dtc_idx; //!< DTC the record belongs to, UDS_EXT_DTC_SNAP_FREE if the slot is free
+	uint8_t rec_num; //!< UDS_EXT_DTC_SNAP_REC_FIRST or UDS_EXT_DTC_SNAP_REC_LAST
+	uint8_t seq; //!< occurrence sequence, a higher value is a more recent capture
+	uint8_t data_arr[UDS_EXT_DTC_SNAP_DATA_SIZE]; //!< DID values in the order of the snapshot description
+} uds_ext_dtc_snap_s;
+
+/**
+ * @brief Structure representing the DTC store.
+ * It is kept as separate arrays indexed by DTC index. The identifiers are sorted, so a DTC is found
+ * by binary search. Every status bit has a bitset with one bit per DTC, so status mask
+ * queries go through 32 DTCs per word instead of looking at every status byte.
+ *
+ * The RAM arrays are owned by the store, the application changes statuses only through
+ * uds_ext_x_set_dtc_st and uds_ext_x_end_dtc_op_cycle.
+ *
+ * Monitors report raw test results, the debounce decides when a result is qualified.
+ * Only qualified results change the status, so a noisy monitor does not cause NVM writes.
+ *
+ * When a DTC fails, its snapshot DIDs are copied into a slot of a RAM ring,
+ * the first occurrence and the most recent one are kept per DTC. The slot is handed
+ * to the NVM write function, which is expected to only update a RAM mirror and let
+ * the NVM commit it later, so the capture costs a bounded copy. ReportDTCSnapshotRecordByDTCNumber
+ * is served from the RAM ring. Every capture stores an occurrence sequence in its slot, so the age
+ * of the records survives a reset. When the ring is full, the record with the oldest sequence is
+ * overwritten, except the first record of the DTC whose most recent record is being captured.
+ *
+ * The core DTC services (read_dtc_info, clear_dtc_info) have to be disabled when the store is used.
+ */
+typedef struct {
+	const uint32_t *id_arr; //!< 24-bit DTC identifiers, sorted ascending, mandatory
+	uint16_t num_dtc; //!< number of DTCs
+	uint8_t *st_arr; //!< RAM, num_dtc status bytes
+	uint32_t *st_bit_arr; //!< RAM, UDS_EXT_DTC_ST_BIT_ARR_SIZE(num_dtc) words, bitset of each status bit
+	uint8_t avail_st_mask; //!< DTCStatusAvailabilityMask, status bits supported by the ECU
+	/// optional, num_dtc debounce parameters.
+	/// NULL takes every result as qualified, confirms at the first failure and never ages.
+	const uds_ext_dtc_deb_cfg_s *deb_cfg_arr;
+	uds_ext_dtc_deb_s *deb_arr; //!< RAM, num_dtc debounce states, mandatory
+	/// NVM address of the DTC records, num_dtc * UDS_EXT_DTC_NVM_REC_SIZE bytes.
+	/// The status byte is written only when a bit of UDS_EXT_DTC_ST_NVM_MASK changes,
+	/// the counters at most once per operation cycle, the extended data once per occurrence.
+	uint32_t nvm_addr;
+	/// optional, num_dtc snapshot descriptions, NULL if no snapshots are captured.
+	/// A DTC without snapshot has num_did 0.
+	const uds_ext_dtc_snap_cfg_s *snap_cfg_arr;
+	uds_ext_dtc_snap_s *snap_arr; //!< RAM, snapshot ring, mandatory if snap_cfg_arr is set
+	uint8_t num_snap; //!< number of snapshot slots, at least 2 to keep the first and the most recent occurrence
+	uint32_t snap_nvm_addr; //!< NVM address of the snapshot ring, num_snap * sizeof(uds_ext_dtc_snap_s) bytes
+	uds_nvm_write_func_t nvm_write_func_ptr; //!< mandatory
+	uds_nvm_read_func_t nvm_read_func_ptr; //!< mandatory
+	uds_ext_access_s read_access; //!< allowed diagnostic sessions and security levels for read DTC information
+	uds_ext_access_s clear_access; //!< allowed diagnostic sessions and security levels for clear diagnostic information
+	uds_ext_access_s setting_access; //!< allowed diagnostic sessions and security levels for control DTC setting
+	/// optional, called when DTC setting is switched, e.g. to hold back NVM commits while it is off
+	uds_ext_dtc_setting_cbk_t setting_cbk_ptr;
+} uds_ext_dtc_s;
+
+/**
+ * @brief The callback function type for communication control changes.
+ * @param rx_en_mask communication types (UDS_EXT_COMM_TYPE_*) whose reception is enabled.
+ * @param tx_en_mask communication types whose transmission is enabled.
+ */
+typedef void (*uds_ext_comm_ctrl_cbk_t)(uint8_t rx_en_mask, uint8_t tx_en_mask);
+
+/**
+ * @brief Structure representing a communication control configuration.
+ * Diagnostic communication is never affected. The application gates its own messages
+ * with uds_ext_x_is_comm_tx_en / uds_ext_x_is_comm_rx_en or the callback.
+ * Everything is enabled again when the default session is entered, S3 timeout included.
+ */
+typedef struct {
+	uds_ext_comm_ctrl_cbk_t cbk_ptr; //!< optional, called when the enabled communication types change
+	uds_ext_access_s access; //!< allowed diagnostic sessions and security levels for communication control
+} uds_ext_comm_ctrl_s;
+
+/**
+ * @brief The function type reading the state of an input output signal as controlled by the ECU.
+ * @param data_ptr Pointer to size bytes of the signal to be filled, big endian.
+ */
+typedef void (*uds_ext_io_ctrl_get_t)(uint8_t *data_ptr);
+
+/**
+ * @brief Structure representing an input output signal which can be taken over by the client.
+ */
+typedef struct {
+	uint16_t did; //!< data identifier of the signal
+	uint8_t size; //!< size of the controlState in bytes, at most UDS_EXT_IO_CTRL_MAX_SIZE
+	/// milliseconds after which an override is returned to the ECU, 0 keeps it until the session changes
+	uint32_t timeout_ms;
+	uds_ext_io_ctrl_get_t get_func_ptr; //!< reads the ECU controlled state, mandatory
+} uds_ext_io_ctrl_sig_s;
+
+/**
+ * @brief RAM override state of an input output signal.
+ */
+typedef struct {
+	bool is_active; //!< true while the client controls the signal
+	uint32_t since_ms; //!< timestamp of the override, wraps around
+	uint8_t val_arr[UDS_EXT_IO_CTRL_MAX_SIZE]; //!< value the signal is held at, big endian
+} uds_ext_io_ctrl_st_s;
+
+/**
+ * @brief Structure representing an input output control configuration.
+ * Overrides are kept in a table indexed like sig_arr, the application looks up its signal
+ * with uds_ext_x_get_io_ctrl before driving the output. Overrides are never written to NVM
+ * and are returned to the ECU on timeout and when the diagnostic session changes, S3 timeout included.
+ */
+typedef struct {
+	const uds_ext_io_ctrl_sig_s *sig_arr; //!< signals, mandatory
+	uds_ext_io_ctrl_st_s *st_arr; //!< RAM, num_sig override states, mandatory
+	uint8_t num_sig; //!< number of signals
+	uds_ext_access_s access; //!< allowed diagnostic sessions and security levels for input output control
+} uds_ext_io_ctrl_s;
+
+/**
+ * @brief The function type switching the bus to a new baudrate.
+ * Called from uds_ext_x_handler once the response has left the controller.
+ * @param baudrate new baudrate in bit/s.
+ */
+typedef void (*uds_ext_link_set_baudrate_t)(uint32_t baudrate);
+/**
+ * @brief The function type telling if all frames were transmitted, e.g. ISO-TP and the TX FIFO are idle.
+ */
+typedef bool (*uds_ext_link_is_tx_idle_t)(void);
+
+/**
+ * @brief Structure representing a link control configuration.
+ * A verified baudrate is switched to by transitionMode. The default one is restored
+ * when the diagnostic session changes, S3 timeout included.
+ */
+typedef struct {
+	const uint32_t *baudrate_arr; //!< supported baudrates in bit/s, default_baudrate is implicitly supported
+	uint8_t num_baudrate; //!< number of supported baudrates
+	uint32_t default_baudrate; //!< baudrate after reset in bit/s
+	uds_ext_link_set_baudrate_t set_baudrate_func_ptr; //!< function switching the baudrate
+	uds_ext_link_is_tx_idle_t is_tx_idle_func_ptr; //!< function telling if the last response left the controller
+	uds_ext_access_s access; //!< allowed diagnostic sessions and security levels for link control
+} uds_ext_link_ctrl_s;
+
+/**
+ * @brief Structure representing the enabled UDS extension services.
+ */
+typedef struct {
+	uint32_t req_upload : 1;
+	uint32_t dtc : 1; //!< read DTC information and clear diagnostic information from the DTC store
+	uint32_t ctrl_dtc_setting : 1; //!< control DTC setting of the DTC store, needs dtc
+	uint32_t comm_ctrl : 1; //!< communication control
+	uint32_t link_ctrl : 1; //!< link control, baudrate transition
+	uint32_t io_ctrl : 1; //!< input output control by identifier
+} uds_ext_is_serv_en_s; //!< Is extension service enabled?
+
+/**
+ * @brief Configuration structure for UDS extension services.
+ */
+typedef struct {
+	uds_ext_is_serv_en_s is_serv_en; //!< is extension service enabled
+
+	uint8_t *tx_ptr; //!< pointer to the transmit buffer, must hold a whole upload block
+	uint16_t tx_buf_size; //!< size of the transmit buffer
+
+	/// response pending is sent this many milliseconds before P2 or P2* expires.
+	/// P2 and P2* are taken from the core UDS configuration.
+	uint16_t resp_pending_margin_ms;
+
+	uds_ext_upload_s upload; //!< request upload configuration
+	uds_ext_dtc_s dtc; //!< DTC store configuration
+	uds_ext_comm_ctrl_s comm_ctrl; //!< communication control configuration
+	uds_ext_link_ctrl_s link_ctrl; //!< link control configuration
+	uds_ext_io_ctrl_s io_ctrl; //!< input output control configuration
+
+	/// optional, user services, e.g. OEM specific ones.
+	/// A user service must not use a SID of an enabled built-in extension service.
+	const uds_ext_serv_s *serv_ptr;
+	int16_t num_serv; //!< number of user services
+} uds_ext_cfg_s;
+
+/**
+ * @brief UDS extension handle structure.
+ * Multiple instances of this handle can be created, each bound to its own core UDS handle.
+ */
+typedef struct {
+	bool is_init; //!< true if the extension handle is initialized
+	const uds_ext_cfg_s *cfg_ptr; //!< pointer to the extension configuration
+	uds_handle_s *uds_handle_ptr; //!< core UDS handle which owns the ISO-TP link and session state
+
+	uint8_t serv_idx_arr[UDS_EXT_NUM_SID]; //!< SID to serv_func_arr index, UDS_EXT_SERV_IDX_NONE if not registered
+	uds_ext_serv_func_t serv_func_arr[UDS_EXT_MAX_SERV]; //!< registered service functions
+	uint8_t num_serv; //!< number of registered service functions
+	uint32_t serv_en_bitmap[UDS_EXT_NUM_SID / 32]; //!< one bit per SID, set if the service is enabled
+	uint8_t diag_sess_cache; //!< diagnostic session diag_sess_bit belongs to
+	uint32_t diag_sess_bit; //!< access mask bit of the current diagnostic session, 0 if not available
+
+	bool is_upload_active; //!< true between accepted request upload and request transfer exit
+	uint32_t upload_addr; //!< address of the next block to be uploaded
+	uint32_t upload_remaining; //!< number of bytes not uploaded yet
+	uint16_t upload_block_size; //!< negotiated maxNumberOfBlockLength
+	uint8_t upload_bsc; //!< block sequence counter of the last served block
+	uint16_t upload_last_size; //!< data size of the last served block, needed for repetition
+
+	uint16_t dtc_st_cnt_arr[UDS_EXT_DTC_NUM_ST_BIT]; //!< number of DTCs with the status bit set, kept in sync with st_bit_arr
+	uint8_t dtc_snap_seq; //!< occurrence sequence of the next snapshot capture
+	bool is_dtc_setting_off; //!< true while control DTC setting is off, test results are ignored
+
+	uint8_t comm_rx_en_mask; //!< communication types whose reception is enabled
+	uint8_t comm_tx_en_mask; //!< communication types whose transmission is enabled
+
+	uint32_t link_baudrate; //!< current baudrate in bit/s
+	uint32_t link_verified_baudrate; //!< baudrate accepted by the last verify request, 0 if none
+	uint32_t link_pending_baudrate; //!< baudrate to switch to once the bus is idle, 0 if none
+
+	bool is_req_open; //!< true while the last received request is not answered yet
+	uint8_t req_sid; //!< service identifier of the last received request
+	uint32_t resp_deadline_ms; //!< timestamp at which the next response pending is due, wraps around
+	uint32_t resp_pending_cnt; //!< number of response pending messages sent for the open request
+	uds_ext_deferred_func_t deferred_func_ptr; //!< processing function of the deferred request, NULL if none
+	void *deferred_arg_ptr; //!< user argument of the deferred processing function
+	uint8_t async_nrc_arr[3]; //!< response pending and busy messages, separate from tx_ptr which may hold the final response
+} uds_ext_handle_s;
+
+/**
+ * @brief Initialize the UDS extension handle with the given configuration.
+ *
+ * @param handle_ptr Pointer to the extension handle to be initialized.
+ * @param cfg_ptr Pointer to the extension configuration structure.
+ * @param uds_handle_ptr Pointer to the initialized core UDS handle.
+ */
+void uds_ext_x_init(
+	uds_ext_handle_s *handle_ptr,
+	const uds_ext_cfg_s *cfg_ptr,
+	uds_handle_s *uds_handle_ptr
+);
+/**
+ * @brief Offer a received packet to the extension services.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param data_ptr Pointer to the received packet.
+ * @param data_size Size of the received packet.
+ * @return true if the packet is consumed by an extension service,
+ * false if it has to be handed to the core UDS implementation.
+ */
+bool uds_ext_x_put_packet_in(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+);
+/**
+ * @brief Process deferred requests and send response pending messages on time.
+ * Call it right after the core UDS handler.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ */
+void uds_ext_x_handler(uds_ext_handle_s *handle_ptr);
+/**
+ * @brief Defer the final response of the request being processed.
+ * Called by an extension service instead of sending the final response.
+ * func_ptr is called from uds_ext_x_handler until it returns UDS_EXT_RESP_DONE,
+ * response pending messages are sent just before P2 and then every P2* expires.
+ * Requests received meanwhile are rejected with busy repeat request, except tester present
+ * which goes on to the core so S3 keeps running.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param func_ptr Function that continues processing and sends the final response.
+ * @param arg_ptr User argument passed to func_ptr.
+ */
+void uds_ext_x_defer(
+	uds_ext_handle_s *handle_ptr,
+	uds_ext_deferred_func_t func_ptr,
+	void *arg_ptr
+);
+/**
+ * @brief Send a response pending message if P2 or P2* of the open request is about to expire.
+ * Meant to be called periodically from long blocking user callbacks of the core UDS
+ * implementation, e.g. flash programming in uds_transfer_data_cbk_t.
+ * Cheap when nothing is due.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ */
+void uds_ext_x_keep_alive(uds_ext_handle_s *handle_ptr);
+/**
+ * @brief Enable or disable a registered service at runtime.
+ * A disabled service is handed to the core UDS implementation.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param sid Service identifier.
+ * @param is_en true to enable.
+ */
+void uds_ext_x_set_serv_en(uds_ext_handle_s *handle_ptr, uint8_t sid, bool is_en);
+/**
+ * @brief Check whether a service is registered and enabled.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param sid Service identifier.
+ * @return true if enabled.
+ */
+bool uds_ext_x_is_serv_en(const uds_ext_handle_s *handle_ptr, uint8_t sid);
+/**
+ * @brief Send a negative response.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param sid Service identifier of the request.
+ * @param nrc Negative response code.
+ */
+void uds_ext_x_neg_resp(uds_ext_handle_s *handle_ptr, uint8_t sid, uint8_t nrc);
+/**
+ * @brief Send the response of a request.
+ * tx_ptr of the extension configuration holds the response.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param size Size of the response.
+ */
+void uds_ext_x_send_resp(uds_ext_handle_s *handle_ptr, uint16_t size);
+/**
+ * @brief Find a DTC by its identifier, binary search over the sorted identifiers.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param dtc_id 24-bit DTC identifier.
+ * @return DTC index, -1 if not found.
+ */
+int32_t uds_ext_x_find_dtc(const uds_ext_handle_s *handle_ptr, uint32_t dtc_id);
+/**
+ * @brief Report the latest raw test result of a DTC.
+ * The result goes through the debounce of the DTC first. Status bits, bitsets and NVM
+ * are updated only when a qualified result changes something, so it is cheap
+ * to call at a high rate. Results are ignored while control DTC setting is off.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param dtc_idx DTC index.
+ * @param is_failed true if the test failed, false if it passed.
+ */
+void uds_ext_x_set_dtc_st(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, bool is_failed);
+/**
+ * @brief End the operation cycle and start the next one.
+ * DTCs tested without failure in the ending cycle clear pendingDTC and age,
+ * testFailedThisOperationCycle is cleared and testNotCompletedThisOperationCycle set for all DTCs.
+ * Call it e.g. before an ECU reset or power down. uds_ext_x_init starts an operation cycle.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ */
+void uds_ext_x_end_dtc_op_cycle(uds_ext_handle_s *handle_ptr);
+/**
+ * @brief Get the status byte of a DTC.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param dtc_idx DTC index.
+ * @return status byte, see UDS_EXT_DTC_ST_*.
+ */
+uint8_t uds_ext_x_get_dtc_st(const uds_ext_handle_s *handle_ptr, uint16_t dtc_idx);
+/**
+ * @brief Check if the application may transmit messages of a communication type.
+ * Cheap enough to be called before every periodic message.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param comm_type UDS_EXT_COMM_TYPE_NORMAL or UDS_EXT_COMM_TYPE_NM.
+ * @return true if transmission is enabled, always true if communication control is not enabled.
+ */
+bool uds_ext_x_is_comm_tx_en(const uds_ext_handle_s *handle_ptr, uint8_t comm_type);
+/**
+ * @brief Check if the application may process received messages of a communication type.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param comm_type UDS_EXT_COMM_TYPE_NORMAL or UDS_EXT_COMM_TYPE_NM.
+ * @return true if reception is enabled, always true if communication control is not enabled.
+ */
+bool uds_ext_x_is_comm_rx_en(const uds_ext_handle_s *handle_ptr, uint8_t comm_type);
+/**
+ * @brief Get the client override of an input output signal.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param sig_idx Index of the signal in sig_arr of the input output control configuration.
+ * @return Pointer to the value the signal has to be held at, big endian,
+ * NULL if the ECU controls the signal.
+ */
+const uint8_t *uds_ext_x_get_io_ctrl(const uds_ext_handle_s *handle_ptr, uint8_t sig_idx);
+/**
+ * @brief Abort any ongoing extension transfer,
+ * return to the default baudrate and return input output signals to the ECU.
+ * DTC setting and communication are switched back on only when the default session is entered.
+ * Call it when the diagnostic session changes, S3 timeout included.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param new_sess The diagnostic session being entered.
+ */
+void uds_ext_x_abort(uds_ext_handle_s *handle_ptr, uint8_t new_sess);
+
+/**
+ * The functions below are wrappers for uds_ext_x_*
+ * bound to _uds_ext_handle, _uds_ext_cfg and _uds_handle.
+ */
+void uds_ext_init(void);
+bool uds_ext_put_packet_in(uint8_t *data_ptr, uint16_t data_size);
+void uds_ext_handler(void);
+void uds_ext_defer(uds_ext_deferred_func_t func_ptr, void *arg_ptr);
+void uds_ext_keep_alive(void);
+void uds_ext_abort(uint8_t new_sess);
+int32_t uds_ext_find_dtc(uint32_t dtc_id);
+void uds_ext_set_dtc_st(uint16_t dtc_idx, bool is_failed);
+void uds_ext_end_dtc_op_cycle(void);
+uint8_t uds_ext_get_dtc_st(uint16_t dtc_idx);
+bool uds_ext_is_comm_tx_en(uint8_t comm_type);
+bool uds_ext_is_comm_rx_en(uint8_t comm_type);
+const uint8_t *uds_ext_get_io_ctrl(uint8_t sig_idx);
+
+extern const uds_ext_cfg_s _uds_ext_cfg;
+extern uds_ext_handle_s _uds_ext_handle;
+
+#endif // UDS_EXT_H
@@ -0,0 +1,124 @@
+#include "uds_ext.h"
+#include "uds_ext_internal.h"
+#include <assert.h>
+#include <stddef.h>
+
+//! communicationType bits which are not communication types
+#define UDS_EXT_COMM_TYPE_RESERVED_MASK ((uint8_t)0x0C)
+//! subnet number of communicationType: all subnets
+#define UDS_EXT_COMM_SUBNET_ALL ((uint8_t)0x00)
+//! subnet number of communicationType: the network the request is received on
+#define UDS_EXT_COMM_SUBNET_RECV ((uint8_t)0x0F)
+
+static void uds_ext_x_comm_set(uds_ext_handle_s *handle_ptr, uint8_t rx_en_mask, uint8_t tx_en_mask)
+{
+	uds_ext_comm_ctrl_cbk_t cbk_ptr = handle_ptr->cfg_ptr->comm_ctrl.cbk_ptr;
+
+	if((handle_ptr->comm_rx_en_mask == rx_en_mask) && (handle_ptr->comm_tx_en_mask == tx_en_mask)) {
+		return;
+	}
+	handle_ptr->comm_rx_en_mask = rx_en_mask;
+	handle_ptr->comm_tx_en_mask = tx_en_mask;
+	if(cbk_ptr != NULL) {
+		cbk_ptr(rx_en_mask, tx_en_mask);
+	}
+}
+
+/**
+ * Only the enabled communication types change, diagnostic messages keep flowing.
+ * This ECU has a single network, so only all subnets or the receiving one are accepted.
+ */
+static bool uds_ext_x_comm_ctrl(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	uint8_t ctrl_type;
+	uint8_t comm_type;
+	uint8_t subnet;
+	uint8_t rx_en_mask;
+	uint8_t tx_en_mask;
+
+	// enhanced address information variants are not supported, so the length is fixed
+	if(data_size != 3) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_COMM_CTRL, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before the sub-function and range checks, like the other extension services
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_COMM_CTRL, &handle_ptr->cfg_ptr->comm_ctrl.access)) {
+		return true;
+	}
+
+	ctrl_type = data_ptr[1] & UDS_EXT_SUB_FUNC_MASK;
+	if(ctrl_type > UDS_EXT_COMM_CTRL_DIS_RX_TX) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_COMM_CTRL, UDS_EXT_NRC_SUB_FUNC_NOT_SUPP);
+		return true;
+	}
+
+	comm_type = data_ptr[2] & UDS_EXT_COMM_TYPE_ALL;
+	subnet = data_ptr[2] >> 4;
+	if(
+		(comm_type == 0) ||
+		((data_ptr[2] & UDS_EXT_COMM_TYPE_RESERVED_MASK) != 0) ||
+		((subnet != UDS_EXT_COMM_SUBNET_ALL) && (subnet != UDS_EXT_COMM_SUBNET_RECV))
+	) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_COMM_CTRL, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	rx_en_mask = handle_ptr->comm_rx_en_mask;
+	tx_en_mask = handle_ptr->comm_tx_en_mask;
+	if((ctrl_type == UDS_EXT_COMM_CTRL_EN_RX_TX) || (ctrl_type == UDS_EXT_COMM_CTRL_EN_RX_DIS_TX)) {
+		rx_en_mask |= comm_type;
+	} else {
+		rx_en_mask &= (uint8_t)~comm_type;
+	}
+	if((ctrl_type == UDS_EXT_COMM_CTRL_EN_RX_TX) || (ctrl_type == UDS_EXT_COMM_CTRL_DIS_RX_EN_TX)) {
+		tx_en_mask |= comm_type;
+	} else {
+		tx_en_mask &= (uint8_t)~comm_type;
+	}
+	uds_ext_x_comm_set(handle_ptr, rx_en_mask, tx_en_mask);
+
+	if((data_ptr[1] & UDS_EXT_SUPPRESS_POS_RESP) == 0) {
+		handle_ptr->cfg_ptr->tx_ptr[0] = UDS_EXT_SID_COMM_CTRL + UDS_EXT_POS_RESP_OFFSET;
+		handle_ptr->cfg_ptr->tx_ptr[1] = ctrl_type;
+		uds_ext_x_send_resp(handle_ptr, 2);
+	}
+	return true;
+}
+
+void uds_ext_x_comm_init(uds_ext_handle_s *handle_ptr)
+{
+	handle_ptr->comm_rx_en_mask = UDS_EXT_COMM_TYPE_ALL;
+	handle_ptr->comm_tx_en_mask = UDS_EXT_COMM_TYPE_ALL;
+
+	if(handle_ptr->cfg_ptr->is_serv_en.comm_ctrl) {
+		uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_COMM_CTRL, uds_ext_x_comm_ctrl);
+	}
+}
+
+void uds_ext_x_comm_abort(uds_ext_handle_s *handle_ptr, uint8_t new_sess)
+{
+	// kept between non-default sessions, so 0x28 0x03 followed by 0x10 0x02 stays in effect
+	if(new_sess == UDS_DIAG_SESS_DEFAULT) {
+		uds_ext_x_comm_set(handle_ptr, UDS_EXT_COMM_TYPE_ALL, UDS_EXT_COMM_TYPE_ALL);
+	}
+}
+
+bool uds_ext_x_is_comm_tx_en(const uds_ext_handle_s *handle_ptr, uint8_t comm_type)
+{
+	assert(handle_ptr != NULL);
+
+	return (handle_ptr->comm_tx_en_mask & comm_type) == comm_type;
+}
+
+bool uds_ext_x_is_comm_rx_en(const uds_ext_handle_s *handle_ptr, uint8_t comm_type)
+{
+	assert(handle_ptr != NULL);
+
+	return (handle_ptr->comm_rx_en_mask & comm_type) == comm_type;
+}
@@ -0,0 +1,1031 @@
+#include "uds_ext.h"
+#include "uds_ext_internal.h"
+#include <assert.h>
+#include <string.h>
+
+//! Size of SID and sub-function of a read DTC information response
+#define UDS_EXT_DTC_RESP_HDR_SIZE 2u
+//! Size of a DTC and status record in a response
+#define UDS_EXT_DTC_REC_SIZE 4u
+//! highest valid 24-bit DTC identifier
+#define UDS_EXT_DTC_ID_MAX ((uint32_t)0xFFFFFF)
+//! offsets in the NVM record of a DTC
+#define UDS_EXT_DTC_NVM_ST_OFFSET 0u
+#define UDS_EXT_DTC_NVM_CNT_OFFSET 1u //!< failed operation cycle counter, then aging counter
+#define UDS_EXT_DTC_NVM_CNT_SIZE 2u
+#define UDS_EXT_DTC_NVM_OCC_OFFSET 3u //!< occurrence counter, then first and last seen timestamps
+#define UDS_EXT_DTC_NVM_OCC_SIZE 9u
+//! Size of an extended data response with all records: header, DTC and status, 2 + 2 + 5 + 5 bytes of records
+#define UDS_EXT_DTC_EXT_DATA_RESP_MAX_SIZE 20u
+//! milliseconds of abs_tim per extended data timestamp unit, abs_tim counts from power-on
+#define UDS_EXT_DTC_SEEN_RESOLUTION_MS 1000u
+
+static uint32_t uds_ext_x_dtc_num_word(const uds_ext_handle_s *handle_ptr)
+{
+	return UDS_EXT_DTC_NUM_WORD(handle_ptr->cfg_ptr->dtc.num_dtc);
+}
+
+//! index of the lowest set bit, w must not be 0
+static uint8_t uds_ext_dtc_lowest_bit(uint32_t w)
+{
+	uint8_t idx = 0;
+
+	if((w & 0xFFFFu) == 0) {
+		w >>= 16;
+		idx += 16;
+	}
+	if((w & 0xFFu) == 0) {
+		w >>= 8;
+		idx += 8;
+	}
+	while((w & 1u) == 0) {
+		w >>= 1;
+		idx++;
+	}
+	return idx;
+}
+
+//! number of set bits
+static uint8_t uds_ext_dtc_bit_cnt(uint32_t w)
+{
+	uint8_t cnt = 0;
+
+	for(; w != 0; w &= w - 1) {
+		cnt++;
+	}
+	return cnt;
+}
+
+/**
+ * Flips the bits of a DTC in the bitsets of the changed status bits
+ * and updates the number of DTCs per status bit.
+ */
+static void uds_ext_x_dtc_flip_st_bits(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, uint8_t diff)
+{
+	uint32_t *st_bit_arr = handle_ptr->cfg_ptr->dtc.st_bit_arr;
+	uint32_t num_word = uds_ext_x_dtc_num_word(handle_ptr);
+	uint32_t word_idx = dtc_idx >> 5;
+	uint32_t bit = 1UL << (dtc_idx & 0x1F);
+	uint32_t *word_ptr;
+
+	for(uint8_t i = 0; i < UDS_EXT_DTC_NUM_ST_BIT; ++i) {
+		if((diff & (1u << i)) != 0) {
+			word_ptr = &st_bit_arr[(i * num_word) + word_idx];
+			*word_ptr ^= bit;
+			if((*word_ptr & bit) != 0) {
+				handle_ptr->dtc_st_cnt_arr[i]++;
+			} else {
+				handle_ptr->dtc_st_cnt_arr[i]--;
+			}
+		}
+	}
+}
+
+/**
+ * Single place where a status byte changes, keeps the bitsets in sync
+ * and writes NVM only if a persistent bit has changed.
+ */
+static void uds_ext_x_dtc_write_st(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, uint8_t st)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uint8_t diff = dtc_ptr->st_arr[dtc_idx] ^ st;
+
+	if(diff == 0) {
+		return;
+	}
+
+	dtc_ptr->st_arr[dtc_idx] = st;
+	uds_ext_x_dtc_flip_st_bits(handle_ptr, dtc_idx, diff);
+
+	if((diff & UDS_EXT_DTC_ST_NVM_MASK) != 0) {
+		dtc_ptr->nvm_write_func_ptr(
+			dtc_ptr->nvm_addr + (dtc_idx * UDS_EXT_DTC_NVM_REC_SIZE) + UDS_EXT_DTC_NVM_ST_OFFSET,
+			&st,
+			1
+		);
+	}
+}
+
+//! Sets the operation cycle counters of a DTC, writes NVM only if they change
+static void uds_ext_x_dtc_write_cnt(
+	uds_ext_handle_s *handle_ptr,
+	uint16_t dtc_idx,
+	uint8_t fail_cycle_cnt,
+	uint8_t aging_cnt
+)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uds_ext_dtc_deb_s *deb_ptr = &dtc_ptr->deb_arr[dtc_idx];
+	uint8_t cnt_arr[UDS_EXT_DTC_NVM_CNT_SIZE];
+
+	if((deb_ptr->fail_cycle_cnt == fail_cycle_cnt) && (deb_ptr->aging_cnt == aging_cnt)) {
+		return;
+	}
+
+	deb_ptr->fail_cycle_cnt = fail_cycle_cnt;
+	deb_ptr->aging_cnt = aging_cnt;
+	cnt_arr[0] = fail_cycle_cnt;
+	cnt_arr[1] = aging_cnt;
+	dtc_ptr->nvm_write_func_ptr(
+		dtc_ptr->nvm_addr + (dtc_idx * UDS_EXT_DTC_NVM_REC_SIZE) + UDS_EXT_DTC_NVM_CNT_OFFSET,
+		cnt_arr,
+		sizeof(cnt_arr)
+	);
+}
+
+//! Writes the occurrence counter and the timestamps of a DTC to NVM
+static void uds_ext_x_dtc_write_occ(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	const uds_ext_dtc_deb_s *deb_ptr = &dtc_ptr->deb_arr[dtc_idx];
+	uint8_t occ_arr[UDS_EXT_DTC_NVM_OCC_SIZE];
+
+	occ_arr[0] = deb_ptr->occ_cnt;
+	uds_ext_put_be(&occ_arr[1], deb_ptr->first_seen_s, 4);
+	uds_ext_put_be(&occ_arr[5], deb_ptr->last_seen_s, 4);
+	dtc_ptr->nvm_write_func_ptr(
+		dtc_ptr->nvm_addr + (dtc_idx * UDS_EXT_DTC_NVM_REC_SIZE) + UDS_EXT_DTC_NVM_OCC_OFFSET,
+		occ_arr,
+		sizeof(occ_arr)
+	);
+}
+
+static uint64_t uds_ext_x_dtc_get_ms(const uds_ext_handle_s *handle_ptr)
+{
+	return abs_tim_x_get(uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr)->abs_tim_handle_ptr);
+}
+
+static const uds_ext_dtc_deb_cfg_s *uds_ext_x_dtc_get_deb_cfg(const uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	const uds_ext_dtc_deb_cfg_s *deb_cfg_arr = handle_ptr->cfg_ptr->dtc.deb_cfg_arr;
+
+	return (deb_cfg_arr != NULL) ? &deb_cfg_arr[dtc_idx] : NULL;
+}
+
+/**
+ * Feeds a raw test result into the debounce of a DTC.
+ *
+ * @return true if the result is qualified.
+ */
+static bool uds_ext_x_dtc_debounce(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, bool is_failed)
+{
+	const uds_ext_dtc_deb_cfg_s *deb_cfg_ptr = uds_ext_x_dtc_get_deb_cfg(handle_ptr, dtc_idx);
+	uds_ext_dtc_deb_s *deb_ptr = &handle_ptr->cfg_ptr->dtc.deb_arr[dtc_idx];
+	int32_t cnt;
+	uint32_t now_ms;
+
+	if(deb_cfg_ptr == NULL) {
+		return true;
+	}
+
+	switch(deb_cfg_ptr->type) {
+	case UDS_EXT_DTC_DEB_CNT:
+		cnt = deb_ptr->cnt;
+		if(is_failed) {
+			cnt += deb_cfg_ptr->inc_step;
+			if(cnt >= (int32_t)deb_cfg_ptr->fail_thr) {
+				deb_ptr->cnt = (int16_t)deb_cfg_ptr->fail_thr;
+				return true;
+			}
+		} else {
+			cnt -= deb_cfg_ptr->dec_step;
+			if(cnt <= -(int32_t)deb_cfg_ptr->pass_thr) {
+				deb_ptr->cnt = (int16_t)-(int32_t)deb_cfg_ptr->pass_thr;
+				return true;
+			}
+		}
+		deb_ptr->cnt = (int16_t)cnt;
+		return false;
+	case UDS_EXT_DTC_DEB_TIME:
+		now_ms = (uint32_t)uds_ext_x_dtc_get_ms(handle_ptr);
+		if((deb_ptr->cnt == 0) || ((deb_ptr->cnt > 0) != is_failed)) {
+			// the result has changed, start over
+			deb_ptr->cnt = is_failed ? 1 : -1;
+			deb_ptr->since_ms = now_ms;
+		}
+		return (now_ms - deb_ptr->since_ms) >= (is_failed ? deb_cfg_ptr->fail_thr : deb_cfg_ptr->pass_thr);
+	default:
+		return true;
+	}
+}
+
+static void uds_ext_x_dtc_write_snap(uds_ext_handle_s *handle_ptr, uint8_t slot_idx)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+
+	dtc_ptr->nvm_write_func_ptr(
+		dtc_ptr->snap_nvm_addr + (slot_idx * sizeof(uds_ext_dtc_snap_s)),
+		(const uint8_t *)&dtc_ptr->snap_arr[slot_idx],
+		sizeof(uds_ext_dtc_snap_s)
+	);
+}
+
+//! slot index of a snapshot record, -1 if not stored
+static int16_t uds_ext_x_dtc_find_snap(const uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, uint8_t rec_num)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+
+	for(uint8_t i = 0; i < dtc_ptr->num_snap; ++i) {
+		if((dtc_ptr->snap_arr[i].dtc_idx == dtc_idx) && (dtc_ptr->snap_arr[i].rec_num == rec_num)) {
+			return (int16_t)i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Renumbers the occurrence sequences of the stored records from 0 in the order of their age,
+ * so the sequence does not run out. Every step takes the oldest record not renumbered yet,
+ * its sequence is never lower than the step, so the renumbered records stay below the others.
+ */
+static void uds_ext_x_dtc_renum_snap(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	int16_t slot_idx;
+	uint8_t seq = 0;
+
+	for(;;) {
+		slot_idx = -1;
+		for(uint8_t i = 0; i < dtc_ptr->num_snap; ++i) {
+			if(
+				(dtc_ptr->snap_arr[i].dtc_idx != UDS_EXT_DTC_SNAP_FREE) &&
+				(dtc_ptr->snap_arr[i].seq >= seq) &&
+				((slot_idx < 0) || (dtc_ptr->snap_arr[i].seq < dtc_ptr->snap_arr[slot_idx].seq))
+			) {
+				slot_idx = (int16_t)i;
+			}
+		}
+		if(slot_idx < 0) {
+			break;
+		}
+		if(dtc_ptr->snap_arr[slot_idx].seq != seq) {
+			dtc_ptr->snap_arr[slot_idx].seq = seq;
+			uds_ext_x_dtc_write_snap(handle_ptr, (uint8_t)slot_idx);
+		}
+		seq++;
+	}
+	handle_ptr->dtc_snap_seq = seq;
+}
+
+/**
+ * A free slot if there is one, otherwise the slot of the oldest record.
+ * The first record of the DTC is kept when its most recent record is allocated.
+ */
+static uint8_t uds_ext_x_dtc_alloc_snap(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, uint8_t rec_num)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	const uds_ext_dtc_snap_s *snap_ptr;
+	int16_t slot_idx = -1;
+
+	for(uint8_t i = 0; i < dtc_ptr->num_snap; ++i) {
+		snap_ptr = &dtc_ptr->snap_arr[i];
+		if(snap_ptr->dtc_idx == UDS_EXT_DTC_SNAP_FREE) {
+			return i;
+		}
+		if(
+			((snap_ptr->dtc_idx != dtc_idx) || (rec_num != UDS_EXT_DTC_SNAP_REC_LAST)) &&
+			((slot_idx < 0) || (snap_ptr->seq < dtc_ptr->snap_arr[slot_idx].seq))
+		) {
+			slot_idx = (int16_t)i;
+		}
+	}
+	assert(slot_idx >= 0); // at least 2 slots, only one of them is the first record of the DTC
+	return (uint8_t)slot_idx;
+}
+
+/**
+ * Captures the snapshot of a DTC at a new occurrence.
+ * The first occurrence gets its own record, later ones overwrite the most recent record.
+ */
+static void uds_ext_x_dtc_capture_snap(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	const uds_ext_dtc_snap_cfg_s *snap_cfg_ptr;
+	const uds_did_s *did_arr;
+	uds_ext_dtc_snap_s *snap_ptr;
+	int16_t slot_idx;
+	uint8_t rec_num = UDS_EXT_DTC_SNAP_REC_LAST;
+	uint16_t size = 0;
+
+	if((dtc_ptr->snap_cfg_arr == NULL) || (dtc_ptr->snap_cfg_arr[dtc_idx].num_did == 0)) {
+		return;
+	}
+
+	slot_idx = uds_ext_x_dtc_find_snap(handle_ptr, dtc_idx, UDS_EXT_DTC_SNAP_REC_LAST);
+	if(slot_idx < 0) {
+		if(uds_ext_x_dtc_find_snap(handle_ptr, dtc_idx, UDS_EXT_DTC_SNAP_REC_FIRST) < 0) {
+			rec_num = UDS_EXT_DTC_SNAP_REC_FIRST;
+		}
+		slot_idx = (int16_t)uds_ext_x_dtc_alloc_snap(handle_ptr, dtc_idx, rec_num);
+	}
+	if(handle_ptr->dtc_snap_seq == UINT8_MAX) {
+		uds_ext_x_dtc_renum_snap(handle_ptr);
+	}
+
+	snap_cfg_ptr = &dtc_ptr->snap_cfg_arr[dtc_idx];
+	did_arr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr)->did_ptr;
+	snap_ptr = &dtc_ptr->snap_arr[slot_idx];
+	snap_ptr->dtc_idx = dtc_idx;
+	snap_ptr->rec_num = rec_num;
+	snap_ptr->seq = handle_ptr->dtc_snap_seq++;
+	for(uint8_t i = 0; i < snap_cfg_ptr->num_did; ++i) {
+		const uds_did_s *did_ptr = &did_arr[snap_cfg_ptr->did_idx_arr[i]];
+
+		(void)memcpy(&snap_ptr->data_arr[size], did_ptr->buf_ptr, did_ptr->buf_size);
+		size += did_ptr->buf_size;
+	}
+	uds_ext_x_dtc_write_snap(handle_ptr, (uint8_t)slot_idx);
+}
+
+//! Updates the occurrence counter and the timestamps at a new occurrence
+static void uds_ext_x_dtc_occurred(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	uds_ext_dtc_deb_s *deb_ptr = &handle_ptr->cfg_ptr->dtc.deb_arr[dtc_idx];
+	uint32_t now_s = (uint32_t)(uds_ext_x_dtc_get_ms(handle_ptr) / UDS_EXT_DTC_SEEN_RESOLUTION_MS);
+
+	if(deb_ptr->occ_cnt == 0) {
+		deb_ptr->first_seen_s = now_s;
+	}
+	if(deb_ptr->occ_cnt < UINT8_MAX) {
+		deb_ptr->occ_cnt++;
+	}
+	deb_ptr->last_seen_s = now_s;
+	uds_ext_x_dtc_write_occ(handle_ptr, dtc_idx);
+}
+
+//! Applies a qualified test result to the status of a DTC
+static void uds_ext_x_dtc_qualified(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, bool is_failed)
+{
+	const uds_ext_dtc_deb_cfg_s *deb_cfg_ptr = uds_ext_x_dtc_get_deb_cfg(handle_ptr, dtc_idx);
+	const uds_ext_dtc_deb_s *deb_ptr = &handle_ptr->cfg_ptr->dtc.deb_arr[dtc_idx];
+	uint8_t st = handle_ptr->cfg_ptr->dtc.st_arr[dtc_idx];
+	uint8_t fail_cycle_cnt = deb_ptr->fail_cycle_cnt;
+
+	st &= (uint8_t)~(UDS_EXT_DTC_ST_TNCSLC | UDS_EXT_DTC_ST_TNCTOC);
+	if(!is_failed) {
+		st &= (uint8_t)~UDS_EXT_DTC_ST_TF;
+	} else {
+		if((st & UDS_EXT_DTC_ST_TFTOC) == 0) {
+			// first failure in this operation cycle, counted right away so a lost cycle end does not lose it
+			if(((st & UDS_EXT_DTC_ST_CDTC) == 0) && (fail_cycle_cnt < UINT8_MAX)) {
+				fail_cycle_cnt++;
+			}
+			if((deb_cfg_ptr == NULL) || (fail_cycle_cnt >= deb_cfg_ptr->confirm_thr)) {
+				st |= UDS_EXT_DTC_ST_CDTC;
+			}
+			uds_ext_x_dtc_write_cnt(handle_ptr, dtc_idx, fail_cycle_cnt, 0);
+		}
+		if((st & UDS_EXT_DTC_ST_TF) == 0) {
+			uds_ext_x_dtc_occurred(handle_ptr, dtc_idx);
+			uds_ext_x_dtc_capture_snap(handle_ptr, dtc_idx);
+		}
+		st |= UDS_EXT_DTC_ST_TF | UDS_EXT_DTC_ST_TFTOC | UDS_EXT_DTC_ST_PDTC | UDS_EXT_DTC_ST_TFSLC;
+	}
+	uds_ext_x_dtc_write_st(handle_ptr, dtc_idx, st);
+}
+
+//! Starts a new operation cycle of a DTC
+static void uds_ext_x_dtc_start_op_cycle(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uint8_t st = dtc_ptr->st_arr[dtc_idx];
+
+	dtc_ptr->deb_arr[dtc_idx].cnt = 0;
+	st &= (uint8_t)~UDS_EXT_DTC_ST_TFTOC;
+	st |= UDS_EXT_DTC_ST_TNCTOC;
+	uds_ext_x_dtc_write_st(handle_ptr, dtc_idx, st);
+}
+
+//! Clears the status, the counters and the snapshots of a DTC
+static void uds_ext_x_dtc_clear(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+
+	if(dtc_ptr->snap_cfg_arr != NULL) {
+		for(uint8_t i = 0; i < dtc_ptr->num_snap; ++i) {
+			if(dtc_ptr->snap_arr[i].dtc_idx == dtc_idx) {
+				dtc_ptr->snap_arr[i].dtc_idx = UDS_EXT_DTC_SNAP_FREE;
+				uds_ext_x_dtc_write_snap(handle_ptr, i);
+			}
+		}
+	}
+	dtc_ptr->deb_arr[dtc_idx].cnt = 0;
+	if(dtc_ptr->deb_arr[dtc_idx].occ_cnt != 0) {
+		dtc_ptr->deb_arr[dtc_idx].occ_cnt = 0;
+		dtc_ptr->deb_arr[dtc_idx].first_seen_s = 0;
+		dtc_ptr->deb_arr[dtc_idx].last_seen_s = 0;
+		uds_ext_x_dtc_write_occ(handle_ptr, dtc_idx);
+	}
+	uds_ext_x_dtc_write_cnt(handle_ptr, dtc_idx, 0, 0);
+	uds_ext_x_dtc_write_st(handle_ptr, dtc_idx, UDS_EXT_DTC_ST_CLEARED);
+}
+
+/**
+ * Word of the bitset of DTCs which have any bit of the mask set.
+ */
+static uint32_t uds_ext_x_dtc_get_match_word(
+	const uds_ext_handle_s *handle_ptr,
+	uint8_t st_mask,
+	uint32_t word_idx
+)
+{
+	const uint32_t *st_bit_arr = handle_ptr->cfg_ptr->dtc.st_bit_arr;
+	uint32_t num_word = uds_ext_x_dtc_num_word(handle_ptr);
+	uint32_t match = 0;
+
+	for(uint8_t i = 0; i < UDS_EXT_DTC_NUM_ST_BIT; ++i) {
+		if((st_mask & (1u << i)) != 0) {
+			match |= st_bit_arr[(i * num_word) + word_idx];
+		}
+	}
+	return match;
+}
+
+/**
+ * Number of DTCs which have any bit of the mask set.
+ * A single status bit is answered from its counter, several bits need the union of their bitsets.
+ */
+static uint16_t uds_ext_x_dtc_get_num_by_st_mask(const uds_ext_handle_s *handle_ptr, uint8_t st_mask)
+{
+	uint32_t num_word;
+	uint16_t cnt = 0;
+
+	if(st_mask == 0) {
+		return 0;
+	}
+	if((st_mask & (st_mask - 1u)) == 0) {
+		return handle_ptr->dtc_st_cnt_arr[uds_ext_dtc_lowest_bit(st_mask)];
+	}
+
+	num_word = uds_ext_x_dtc_num_word(handle_ptr);
+	for(uint32_t w = 0; w < num_word; ++w) {
+		cnt += uds_ext_dtc_bit_cnt(uds_ext_x_dtc_get_match_word(handle_ptr, st_mask, w));
+	}
+	return cnt;
+}
+
+static bool uds_ext_x_dtc_report_num_by_st_mask(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uint8_t *tx_ptr = handle_ptr->cfg_ptr->tx_ptr;
+	uint16_t cnt;
+
+	if(data_size != 3) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, &dtc_ptr->read_access)) {
+		return true;
+	}
+
+	cnt = uds_ext_x_dtc_get_num_by_st_mask(handle_ptr, data_ptr[2] & dtc_ptr->avail_st_mask);
+
+	tx_ptr[0] = UDS_EXT_SID_READ_DTC_INFO + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = UDS_EXT_DTC_REPORT_NUM_BY_ST_MASK;
+	tx_ptr[2] = dtc_ptr->avail_st_mask;
+	tx_ptr[3] = UDS_EXT_DTC_FORMAT_ISO14229;
+	tx_ptr[4] = (uint8_t)(cnt >> 8);
+	tx_ptr[5] = (uint8_t)cnt;
+
+	uds_ext_x_send_resp(handle_ptr, 6);
+	return true;
+}
+
+static bool uds_ext_x_dtc_report_by_st_mask(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	const uds_ext_cfg_s *cfg_ptr = handle_ptr->cfg_ptr;
+	const uds_ext_dtc_s *dtc_ptr = &cfg_ptr->dtc;
+	uint8_t *tx_ptr = cfg_ptr->tx_ptr;
+	uint32_t num_word = uds_ext_x_dtc_num_word(handle_ptr);
+	uint16_t size = UDS_EXT_DTC_RESP_HDR_SIZE + 1;
+	uint8_t st_mask;
+	uint32_t match;
+	uint16_t dtc_idx;
+
+	if(data_size != 3) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, &dtc_ptr->read_access)) {
+		return true;
+	}
+
+	st_mask = data_ptr[2] & dtc_ptr->avail_st_mask;
+
+	tx_ptr[0] = UDS_EXT_SID_READ_DTC_INFO + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = UDS_EXT_DTC_REPORT_BY_ST_MASK;
+	tx_ptr[2] = dtc_ptr->avail_st_mask;
+
+	for(uint32_t w = 0; (w < num_word) && (st_mask != 0); ++w) {
+		// 32 DTCs at once, only the matching ones are visited
+		for(match = uds_ext_x_dtc_get_match_word(handle_ptr, st_mask, w); match != 0; match &= match - 1) {
+			if((size + UDS_EXT_DTC_REC_SIZE) > cfg_ptr->tx_buf_size) {
+				uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_RESP_TOO_LONG);
+				return true;
+			}
+			dtc_idx = (uint16_t)((w << 5) + uds_ext_dtc_lowest_bit(match));
+			tx_ptr[size++] = (uint8_t)(dtc_ptr->id_arr[dtc_idx] >> 16);
+			tx_ptr[size++] = (uint8_t)(dtc_ptr->id_arr[dtc_idx] >> 8);
+			tx_ptr[size++] = (uint8_t)dtc_ptr->id_arr[dtc_idx];
+			tx_ptr[size++] = dtc_ptr->st_arr[dtc_idx] & dtc_ptr->avail_st_mask;
+		}
+	}
+
+	uds_ext_x_send_resp(handle_ptr, size);
+	return true;
+}
+
+//! Appends a snapshot record, false if it does not fit in the transmit buffer
+static bool uds_ext_x_dtc_put_snap(const uds_ext_handle_s *handle_ptr, const uds_ext_dtc_snap_s *snap_ptr, uint16_t *size_ptr)
+{
+	const uds_ext_cfg_s *cfg_ptr = handle_ptr->cfg_ptr;
+	const uds_ext_dtc_snap_cfg_s *snap_cfg_ptr = &cfg_ptr->dtc.snap_cfg_arr[snap_ptr->dtc_idx];
+	const uds_did_s *did_arr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr)->did_ptr;
+	uint8_t *tx_ptr = cfg_ptr->tx_ptr;
+	uint16_t size = *size_ptr;
+	uint16_t data_idx = 0;
+
+	if((size + 2u) > cfg_ptr->tx_buf_size) {
+		return false;
+	}
+	tx_ptr[size++] = snap_ptr->rec_num;
+	tx_ptr[size++] = snap_cfg_ptr->num_did;
+	for(uint8_t i = 0; i < snap_cfg_ptr->num_did; ++i) {
+		const uds_did_s *did_ptr = &did_arr[snap_cfg_ptr->did_idx_arr[i]];
+
+		if((size + 2u + did_ptr->buf_size) > cfg_ptr->tx_buf_size) {
+			return false;
+		}
+		tx_ptr[size++] = (uint8_t)(did_ptr->did >> 8);
+		tx_ptr[size++] = (uint8_t)did_ptr->did;
+		(void)memcpy(&tx_ptr[size], &snap_ptr->data_arr[data_idx], did_ptr->buf_size);
+		size += did_ptr->buf_size;
+		data_idx += did_ptr->buf_size;
+	}
+	*size_ptr = size;
+	return true;
+}
+
+static bool uds_ext_x_dtc_report_snap_by_dtc(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uint8_t *tx_ptr = handle_ptr->cfg_ptr->tx_ptr;
+	uint16_t size = UDS_EXT_DTC_RESP_HDR_SIZE;
+	uint8_t rec_num;
+	int32_t dtc_idx;
+	int16_t slot_idx;
+
+	if(data_size != 6) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before the DTC and record checks, so a locked client learns nothing about the stored DTCs
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, &dtc_ptr->read_access)) {
+		return true;
+	}
+
+	dtc_idx = uds_ext_x_find_dtc(handle_ptr, uds_ext_get_be(&data_ptr[2], 3));
+	rec_num = data_ptr[5];
+	if(
+		(dtc_idx < 0) ||
+		(dtc_ptr->snap_cfg_arr == NULL) ||
+		(
+			(rec_num != UDS_EXT_DTC_SNAP_REC_FIRST) &&
+			(rec_num != UDS_EXT_DTC_SNAP_REC_LAST) &&
+			(rec_num != UDS_EXT_DTC_SNAP_REC_ALL)
+		)
+	) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	tx_ptr[0] = UDS_EXT_SID_READ_DTC_INFO + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = UDS_EXT_DTC_REPORT_SNAP_BY_DTC;
+	(void)memcpy(&tx_ptr[size], &data_ptr[2], 3);
+	size += 3;
+	tx_ptr[size++] = dtc_ptr->st_arr[dtc_idx] & dtc_ptr->avail_st_mask;
+
+	for(uint8_t r = UDS_EXT_DTC_SNAP_REC_FIRST; r <= UDS_EXT_DTC_SNAP_REC_LAST; ++r) {
+		if((rec_num != UDS_EXT_DTC_SNAP_REC_ALL) && (rec_num != r)) {
+			continue;
+		}
+		slot_idx = uds_ext_x_dtc_find_snap(handle_ptr, (uint16_t)dtc_idx, r);
+		if(
+			(slot_idx >= 0) &&
+			!uds_ext_x_dtc_put_snap(handle_ptr, &dtc_ptr->snap_arr[slot_idx], &size)
+		) {
+			uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_RESP_TOO_LONG);
+			return true;
+		}
+	}
+
+	uds_ext_x_send_resp(handle_ptr, size);
+	return true;
+}
+
+static bool uds_ext_x_dtc_report_ext_data_by_dtc(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	const uds_ext_dtc_deb_s *deb_ptr;
+	uint8_t *tx_ptr = handle_ptr->cfg_ptr->tx_ptr;
+	uint16_t size = UDS_EXT_DTC_RESP_HDR_SIZE;
+	uint8_t rec_num;
+	int32_t dtc_idx;
+
+	if(data_size != 6) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before the DTC and record checks, so a locked client learns nothing about the stored DTCs
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, &dtc_ptr->read_access)) {
+		return true;
+	}
+
+	dtc_idx = uds_ext_x_find_dtc(handle_ptr, uds_ext_get_be(&data_ptr[2], 3));
+	rec_num = data_ptr[5];
+	if(
+		(dtc_idx < 0) ||
+		(
+			((rec_num < UDS_EXT_DTC_EXT_REC_OCC) || (rec_num > UDS_EXT_DTC_EXT_REC_LAST_SEEN)) &&
+			(rec_num != UDS_EXT_DTC_EXT_REC_ALL)
+		)
+	) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	if(handle_ptr->cfg_ptr->tx_buf_size < UDS_EXT_DTC_EXT_DATA_RESP_MAX_SIZE) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_RESP_TOO_LONG);
+		return true;
+	}
+
+	deb_ptr = &dtc_ptr->deb_arr[dtc_idx];
+	tx_ptr[0] = UDS_EXT_SID_READ_DTC_INFO + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = UDS_EXT_DTC_REPORT_EXT_DATA_BY_DTC;
+	(void)memcpy(&tx_ptr[size], &data_ptr[2], 3);
+	size += 3;
+	tx_ptr[size++] = dtc_ptr->st_arr[dtc_idx] & dtc_ptr->avail_st_mask;
+
+	if((rec_num == UDS_EXT_DTC_EXT_REC_OCC) || (rec_num == UDS_EXT_DTC_EXT_REC_ALL)) {
+		tx_ptr[size++] = UDS_EXT_DTC_EXT_REC_OCC;
+		tx_ptr[size++] = deb_ptr->occ_cnt;
+	}
+	if((rec_num == UDS_EXT_DTC_EXT_REC_AGING) || (rec_num == UDS_EXT_DTC_EXT_REC_ALL)) {
+		tx_ptr[size++] = UDS_EXT_DTC_EXT_REC_AGING;
+		tx_ptr[size++] = deb_ptr->aging_cnt;
+	}
+	if((rec_num == UDS_EXT_DTC_EXT_REC_FIRST_SEEN) || (rec_num == UDS_EXT_DTC_EXT_REC_ALL)) {
+		tx_ptr[size++] = UDS_EXT_DTC_EXT_REC_FIRST_SEEN;
+		uds_ext_put_be(&tx_ptr[size], deb_ptr->first_seen_s, 4);
+		size += 4;
+	}
+	if((rec_num == UDS_EXT_DTC_EXT_REC_LAST_SEEN) || (rec_num == UDS_EXT_DTC_EXT_REC_ALL)) {
+		tx_ptr[size++] = UDS_EXT_DTC_EXT_REC_LAST_SEEN;
+		uds_ext_put_be(&tx_ptr[size], deb_ptr->last_seen_s, 4);
+		size += 4;
+	}
+
+	uds_ext_x_send_resp(handle_ptr, size);
+	return true;
+}
+
+static bool uds_ext_x_read_dtc_info(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+
+	if(data_size < 2) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	switch(data_ptr[1]) {
+	case UDS_EXT_DTC_REPORT_NUM_BY_ST_MASK:
+		return uds_ext_x_dtc_report_num_by_st_mask(handle_ptr, data_ptr, data_size);
+	case UDS_EXT_DTC_REPORT_BY_ST_MASK:
+		return uds_ext_x_dtc_report_by_st_mask(handle_ptr, data_ptr, data_size);
+	case UDS_EXT_DTC_REPORT_SNAP_BY_DTC:
+		return uds_ext_x_dtc_report_snap_by_dtc(handle_ptr, data_ptr, data_size);
+	case UDS_EXT_DTC_REPORT_EXT_DATA_BY_DTC:
+		return uds_ext_x_dtc_report_ext_data_by_dtc(handle_ptr, data_ptr, data_size);
+	default:
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, UDS_EXT_NRC_SUB_FUNC_NOT_SUPP);
+		return true;
+	}
+}
+
+/**
+ * Clears a DTC or all of them, with their counters and snapshots.
+ */
+static bool uds_ext_x_clear_diag_info(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uint32_t group;
+	int32_t dtc_idx;
+
+	if(data_size != 4) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_CLEAR_DIAG_INFO, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before the group check, so a locked client learns nothing about the stored DTCs
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_CLEAR_DIAG_INFO, &dtc_ptr->clear_access)) {
+		return true;
+	}
+
+	group = uds_ext_get_be(&data_ptr[1], 3);
+	dtc_idx = uds_ext_x_find_dtc(handle_ptr, group);
+	if((group != UDS_EXT_DTC_GROUP_ALL) && (dtc_idx < 0)) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_CLEAR_DIAG_INFO, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	if(group == UDS_EXT_DTC_GROUP_ALL) {
+		for(uint16_t i = 0; i < dtc_ptr->num_dtc; ++i) {
+			uds_ext_x_dtc_clear(handle_ptr, i);
+		}
+	} else {
+		uds_ext_x_dtc_clear(handle_ptr, (uint16_t)dtc_idx);
+	}
+
+	handle_ptr->cfg_ptr->tx_ptr[0] = UDS_EXT_SID_CLEAR_DIAG_INFO + UDS_EXT_POS_RESP_OFFSET;
+	uds_ext_x_send_resp(handle_ptr, 1);
+	return true;
+}
+
+static void uds_ext_x_dtc_set_setting(uds_ext_handle_s *handle_ptr, bool is_on)
+{
+	uds_ext_dtc_setting_cbk_t cbk_ptr = handle_ptr->cfg_ptr->dtc.setting_cbk_ptr;
+
+	if(handle_ptr->is_dtc_setting_off == !is_on) {
+		return;
+	}
+	handle_ptr->is_dtc_setting_off = !is_on;
+	if(cbk_ptr != NULL) {
+		cbk_ptr(is_on);
+	}
+}
+
+/**
+ * While DTC setting is off, test results are dropped in uds_ext_x_set_dtc_st,
+ * so nothing is written to NVM, e.g. during programming.
+ * It stays off until it is switched on or the default session is entered.
+ */
+static bool uds_ext_x_ctrl_dtc_setting(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	uint8_t sub_func;
+
+	// DTCSettingControlOptionRecord is optional and not evaluated, all DTCs are affected
+	if(data_size < 2) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_CTRL_DTC_SETTING, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	if(!uds_ext_x_check_allowed(
+		handle_ptr,
+		UDS_EXT_SID_CTRL_DTC_SETTING,
+		&handle_ptr->cfg_ptr->dtc.setting_access
+	)) {
+		return true;
+	}
+
+	sub_func = data_ptr[1] & UDS_EXT_SUB_FUNC_MASK;
+	if((sub_func != UDS_EXT_DTC_SETTING_ON) && (sub_func != UDS_EXT_DTC_SETTING_OFF)) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_CTRL_DTC_SETTING, UDS_EXT_NRC_SUB_FUNC_NOT_SUPP);
+		return true;
+	}
+
+	uds_ext_x_dtc_set_setting(handle_ptr, sub_func == UDS_EXT_DTC_SETTING_ON);
+
+	if((data_ptr[1] & UDS_EXT_SUPPRESS_POS_RESP) == 0) {
+		handle_ptr->cfg_ptr->tx_ptr[0] = UDS_EXT_SID_CTRL_DTC_SETTING + UDS_EXT_POS_RESP_OFFSET;
+		handle_ptr->cfg_ptr->tx_ptr[1] = sub_func;
+		uds_ext_x_send_resp(handle_ptr, 2);
+	}
+	return true;
+}
+
+//! Loads the snapshot ring from NVM, slots which do not hold a valid record become free
+static void uds_ext_x_dtc_snap_init(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	const uds_cfg_s *uds_cfg_ptr = uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr);
+	uds_ext_dtc_snap_s *snap_ptr;
+	uint16_t size;
+
+	assert(dtc_ptr->snap_arr != NULL);
+	assert(dtc_ptr->num_snap >= 2);
+	assert(dtc_ptr->num_snap < UINT8_MAX); // room for the sequence of the next capture after renumbering
+	assert(dtc_ptr->num_dtc < UDS_EXT_DTC_SNAP_FREE);
+
+	for(uint16_t i = 0; i < dtc_ptr->num_dtc; ++i) {
+		size = 0;
+		for(uint8_t j = 0; j < dtc_ptr->snap_cfg_arr[i].num_did; ++j) {
+			assert(dtc_ptr->snap_cfg_arr[i].did_idx_arr[j] < uds_cfg_ptr->num_did);
+			size += uds_cfg_ptr->did_ptr[dtc_ptr->snap_cfg_arr[i].did_idx_arr[j]].buf_size;
+		}
+		assert(size <= UDS_EXT_DTC_SNAP_DATA_SIZE);
+	}
+
+	dtc_ptr->nvm_read_func_ptr(
+		dtc_ptr->snap_nvm_addr,
+		(uint8_t *)dtc_ptr->snap_arr,
+		dtc_ptr->num_snap * sizeof(uds_ext_dtc_snap_s)
+	);
+	for(uint8_t i = 0; i < dtc_ptr->num_snap; ++i) {
+		snap_ptr = &dtc_ptr->snap_arr[i];
+		if(
+			(snap_ptr->dtc_idx >= dtc_ptr->num_dtc) ||
+			(dtc_ptr->snap_cfg_arr[snap_ptr->dtc_idx].num_did == 0) ||
+			(
+				(snap_ptr->rec_num != UDS_EXT_DTC_SNAP_REC_FIRST) &&
+				(snap_ptr->rec_num != UDS_EXT_DTC_SNAP_REC_LAST)
+			)
+		) {
+			snap_ptr->dtc_idx = UDS_EXT_DTC_SNAP_FREE; // e.g. blank NVM, written with the next capture
+		}
+	}
+	// the sequence goes on after the most recent stored record, compacted if it is about to run out
+	handle_ptr->dtc_snap_seq = 0;
+	for(uint8_t i = 0; i < dtc_ptr->num_snap; ++i) {
+		snap_ptr = &dtc_ptr->snap_arr[i];
+		if((snap_ptr->dtc_idx != UDS_EXT_DTC_SNAP_FREE) && (snap_ptr->seq >= handle_ptr->dtc_snap_seq)) {
+			handle_ptr->dtc_snap_seq = (snap_ptr->seq == UINT8_MAX) ? UINT8_MAX : (uint8_t)(snap_ptr->seq + 1u);
+		}
+	}
+}
+
+void uds_ext_x_dtc_init(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_dtc_s *dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	uint8_t rec_arr[UDS_EXT_DTC_NVM_REC_SIZE];
+	uint32_t num_word;
+	uint8_t st;
+
+	assert(dtc_ptr->id_arr != NULL);
+	assert(dtc_ptr->num_dtc > 0);
+	assert(dtc_ptr->st_arr != NULL);
+	assert(dtc_ptr->st_bit_arr != NULL);
+	assert(dtc_ptr->deb_arr != NULL);
+	assert(dtc_ptr->nvm_write_func_ptr != NULL);
+	assert(dtc_ptr->nvm_read_func_ptr != NULL);
+
+	for(uint16_t i = 0; i < dtc_ptr->num_dtc; ++i) {
+		assert(dtc_ptr->id_arr[i] <= UDS_EXT_DTC_ID_MAX);
+		assert((i == 0) || (dtc_ptr->id_arr[i - 1] < dtc_ptr->id_arr[i])); // sorted, no duplicates
+	}
+
+	num_word = uds_ext_x_dtc_num_word(handle_ptr);
+	(void)memset(dtc_ptr->st_bit_arr, 0, UDS_EXT_DTC_NUM_ST_BIT * num_word * sizeof(uint32_t));
+	(void)memset(dtc_ptr->deb_arr, 0, dtc_ptr->num_dtc * sizeof(uds_ext_dtc_deb_s));
+	for(uint16_t i = 0; i < dtc_ptr->num_dtc; ++i) {
+		dtc_ptr->nvm_read_func_ptr(dtc_ptr->nvm_addr + (i * UDS_EXT_DTC_NVM_REC_SIZE), rec_arr, sizeof(rec_arr));
+		// new operation cycle, only the persistent bits are taken over
+		st = (rec_arr[UDS_EXT_DTC_NVM_ST_OFFSET] & UDS_EXT_DTC_ST_NVM_MASK) | UDS_EXT_DTC_ST_TNCTOC;
+		dtc_ptr->st_arr[i] = st;
+		uds_ext_x_dtc_flip_st_bits(handle_ptr, i, st);
+		dtc_ptr->deb_arr[i].fail_cycle_cnt = rec_arr[UDS_EXT_DTC_NVM_CNT_OFFSET];
+		dtc_ptr->deb_arr[i].aging_cnt = rec_arr[UDS_EXT_DTC_NVM_CNT_OFFSET + 1u];
+		dtc_ptr->deb_arr[i].occ_cnt = rec_arr[UDS_EXT_DTC_NVM_OCC_OFFSET];
+		dtc_ptr->deb_arr[i].first_seen_s = uds_ext_get_be(&rec_arr[UDS_EXT_DTC_NVM_OCC_OFFSET + 1u], 4);
+		dtc_ptr->deb_arr[i].last_seen_s = uds_ext_get_be(&rec_arr[UDS_EXT_DTC_NVM_OCC_OFFSET + 5u], 4);
+	}
+
+	if(dtc_ptr->snap_cfg_arr != NULL) {
+		uds_ext_x_dtc_snap_init(handle_ptr);
+	}
+
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_READ_DTC_INFO, uds_ext_x_read_dtc_info);
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_CLEAR_DIAG_INFO, uds_ext_x_clear_diag_info);
+	if(handle_ptr->cfg_ptr->is_serv_en.ctrl_dtc_setting) {
+		uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_CTRL_DTC_SETTING, uds_ext_x_ctrl_dtc_setting);
+	}
+}
+
+void uds_ext_x_dtc_abort(uds_ext_handle_s *handle_ptr, uint8_t new_sess)
+{
+	// DTC setting stays off between non-default sessions, e.g. extended to programming
+	if(new_sess == UDS_DIAG_SESS_DEFAULT) {
+		uds_ext_x_dtc_set_setting(handle_ptr, true);
+	}
+}
+
+int32_t uds_ext_x_find_dtc(const uds_ext_handle_s *handle_ptr, uint32_t dtc_id)
+{
+	const uds_ext_dtc_s *dtc_ptr;
+	uint32_t low = 0;
+	uint32_t high;
+	uint32_t mid;
+
+	assert(handle_ptr != NULL);
+
+	dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	high = dtc_ptr->num_dtc;
+	while(low < high) {
+		mid = low + ((high - low) >> 1);
+		if(dtc_ptr->id_arr[mid] < dtc_id) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	if((low < dtc_ptr->num_dtc) && (dtc_ptr->id_arr[low] == dtc_id)) {
+		return (int32_t)low;
+	}
+	return -1;
+}
+
+void uds_ext_x_set_dtc_st(uds_ext_handle_s *handle_ptr, uint16_t dtc_idx, bool is_failed)
+{
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->cfg_ptr->is_serv_en.dtc);
+	assert(dtc_idx < handle_ptr->cfg_ptr->dtc.num_dtc);
+
+	if(handle_ptr->is_dtc_setting_off) {
+		return;
+	}
+
+	if(uds_ext_x_dtc_debounce(handle_ptr, dtc_idx, is_failed)) {
+		uds_ext_x_dtc_qualified(handle_ptr, dtc_idx, is_failed);
+	}
+}
+
+void uds_ext_x_end_dtc_op_cycle(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_dtc_s *dtc_ptr;
+	const uds_ext_dtc_deb_cfg_s *deb_cfg_ptr;
+	const uds_ext_dtc_deb_s *deb_ptr;
+	uint8_t st;
+	uint8_t aging_cnt;
+
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->cfg_ptr->is_serv_en.dtc);
+
+	dtc_ptr = &handle_ptr->cfg_ptr->dtc;
+	for(uint16_t i = 0; i < dtc_ptr->num_dtc; ++i) {
+		st = dtc_ptr->st_arr[i];
+		if((st & (UDS_EXT_DTC_ST_TNCTOC | UDS_EXT_DTC_ST_TFTOC)) == 0) {
+			// tested and passed the whole cycle
+			deb_cfg_ptr = uds_ext_x_dtc_get_deb_cfg(handle_ptr, i);
+			deb_ptr = &dtc_ptr->deb_arr[i];
+			aging_cnt = 0;
+			st &= (uint8_t)~UDS_EXT_DTC_ST_PDTC;
+			if(
+				((st & UDS_EXT_DTC_ST_CDTC) != 0) &&
+				(deb_cfg_ptr != NULL) &&
+				(deb_cfg_ptr->aging_thr != 0)
+			) {
+				aging_cnt = deb_ptr->aging_cnt + 1u;
+				if(aging_cnt >= deb_cfg_ptr->aging_thr) {
+					st &= (uint8_t)~UDS_EXT_DTC_ST_CDTC;
+					aging_cnt = 0;
+				}
+			}
+			uds_ext_x_dtc_write_cnt(handle_ptr, i, 0, aging_cnt);
+			uds_ext_x_dtc_write_st(handle_ptr, i, st);
+		}
+		uds_ext_x_dtc_start_op_cycle(handle_ptr, i);
+	}
+}
+
+uint8_t uds_ext_x_get_dtc_st(const uds_ext_handle_s *handle_ptr, uint16_t dtc_idx)
+{
+	assert(handle_ptr != NULL);
+	assert(dtc_idx < handle_ptr->cfg_ptr->dtc.num_dtc);
+
+	return handle_ptr->cfg_ptr->dtc.st_arr[dtc_idx];
+}
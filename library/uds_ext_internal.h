@@ -0,0 +1,59 @@
+/**
+ * @file uds_ext_internal.h
+ * @brief Functions shared between the UDS extension service implementations.
+ * Not meant to be used by the application.
+ */
+
+#ifndef UDS_EXT_INTERNAL_H
+#define UDS_EXT_INTERNAL_H
+
+#include "uds_ext.h"
+
+/**
+ * @brief Add a service to the dispatch table and enable it.
+ *
+ * @param handle_ptr Pointer to the extension handle.
+ * @param sid Service identifier.
+ * @param func_ptr Service function.
+ */
+void uds_ext_x_register_serv(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t sid,
+	uds_ext_serv_func_t func_ptr
+);
+
+/**
+ * @brief Check security level and diagnostic session, send negative response if not allowed.
+ *
+ * @return true if allowed.
+ */
+bool uds_ext_x_check_allowed(
+	uds_ext_handle_s *handle_ptr,
+	uint8_t sid,
+	const uds_ext_access_s *access_ptr
+);
+
+/**
+ * @brief Read a big endian unsigned value of len bytes, len is at most 4.
+ */
+uint32_t uds_ext_get_be(const uint8_t *data_ptr, uint8_t len);
+/**
+ * @brief Write an unsigned value big endian into len bytes, len is at most 4.
+ */
+void uds_ext_put_be(uint8_t *data_ptr, uint32_t val, uint8_t len);
+
+//! Built-in services, registered by uds_ext_x_init if enabled
+void uds_ext_x_upload_init(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_upload_abort(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_dtc_init(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_dtc_abort(uds_ext_handle_s *handle_ptr, uint8_t new_sess);
+void uds_ext_x_comm_init(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_comm_abort(uds_ext_handle_s *handle_ptr, uint8_t new_sess);
+void uds_ext_x_link_init(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_link_handler(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_link_abort(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_io_init(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_io_handler(uds_ext_handle_s *handle_ptr);
+void uds_ext_x_io_abort(uds_ext_handle_s *handle_ptr);
+
+#endif // UDS_EXT_INTERNAL_H
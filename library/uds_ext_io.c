@@ -0,0 +1,163 @@
+#include "uds_ext.h"
+#include "uds_ext_internal.h"
+#include <assert.h>
+#include <string.h>
+
+//! Size of the request without controlState: SID, DID and inputOutputControlParameter
+#define UDS_EXT_IO_CTRL_REQ_HDR_SIZE 4u
+
+static uint32_t uds_ext_x_io_get_ms(const uds_ext_handle_s *handle_ptr)
+{
+	return (uint32_t)abs_tim_x_get(uds_x_get_cfg_ptr(handle_ptr->uds_handle_ptr)->abs_tim_handle_ptr);
+}
+
+static int16_t uds_ext_x_io_find(const uds_ext_handle_s *handle_ptr, uint16_t did)
+{
+	const uds_ext_io_ctrl_s *io_ptr = &handle_ptr->cfg_ptr->io_ctrl;
+
+	// a handful of actuators, a linear search is cheaper than keeping them sorted
+	for(uint8_t i = 0; i < io_ptr->num_sig; ++i) {
+		if(io_ptr->sig_arr[i].did == did) {
+			return (int16_t)i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * The controlStatusRecord is the state the signal is in after the request:
+ * the held value while overridden, the ECU controlled state otherwise.
+ * Only one signal per DID is supported, so there is no controlEnableMaskRecord.
+ */
+static bool uds_ext_x_io_ctrl(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	const uds_ext_io_ctrl_s *io_ptr = &handle_ptr->cfg_ptr->io_ctrl;
+	const uds_ext_io_ctrl_sig_s *sig_ptr;
+	uds_ext_io_ctrl_st_s *st_ptr;
+	uint8_t *tx_ptr = handle_ptr->cfg_ptr->tx_ptr;
+	uint16_t req_size = UDS_EXT_IO_CTRL_REQ_HDR_SIZE;
+	int16_t sig_idx;
+	uint8_t param;
+
+	if(data_size < UDS_EXT_IO_CTRL_REQ_HDR_SIZE) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_IO_CTRL_BY_ID, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before the DID and length checks, so a locked client learns nothing about the controlled DIDs
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_IO_CTRL_BY_ID, &io_ptr->access)) {
+		return true;
+	}
+
+	sig_idx = uds_ext_x_io_find(handle_ptr, (uint16_t)uds_ext_get_be(&data_ptr[1], 2));
+	param = data_ptr[3];
+	if(
+		(sig_idx < 0) ||
+		(
+			(param != UDS_EXT_IO_CTRL_RETURN_TO_ECU) &&
+			(param != UDS_EXT_IO_CTRL_FREEZE) &&
+			(param != UDS_EXT_IO_CTRL_SHORT_TERM_ADJ)
+		)
+	) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_IO_CTRL_BY_ID, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+	sig_ptr = &io_ptr->sig_arr[sig_idx];
+	st_ptr = &io_ptr->st_arr[sig_idx];
+
+	if(param == UDS_EXT_IO_CTRL_SHORT_TERM_ADJ) {
+		req_size += sig_ptr->size;
+	}
+	if(data_size != req_size) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_IO_CTRL_BY_ID, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	switch(param) {
+	case UDS_EXT_IO_CTRL_FREEZE:
+		sig_ptr->get_func_ptr(st_ptr->val_arr);
+		st_ptr->is_active = true;
+		break;
+	case UDS_EXT_IO_CTRL_SHORT_TERM_ADJ:
+		(void)memcpy(st_ptr->val_arr, &data_ptr[UDS_EXT_IO_CTRL_REQ_HDR_SIZE], sig_ptr->size);
+		st_ptr->is_active = true;
+		break;
+	default:
+		st_ptr->is_active = false;
+		break;
+	}
+	st_ptr->since_ms = uds_ext_x_io_get_ms(handle_ptr);
+
+	tx_ptr[0] = UDS_EXT_SID_IO_CTRL_BY_ID + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = data_ptr[1];
+	tx_ptr[2] = data_ptr[2];
+	tx_ptr[3] = param;
+	if(st_ptr->is_active) {
+		(void)memcpy(&tx_ptr[UDS_EXT_IO_CTRL_REQ_HDR_SIZE], st_ptr->val_arr, sig_ptr->size);
+	} else {
+		sig_ptr->get_func_ptr(&tx_ptr[UDS_EXT_IO_CTRL_REQ_HDR_SIZE]);
+	}
+	uds_ext_x_send_resp(handle_ptr, UDS_EXT_IO_CTRL_REQ_HDR_SIZE + sig_ptr->size);
+	return true;
+}
+
+void uds_ext_x_io_init(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_io_ctrl_s *io_ptr = &handle_ptr->cfg_ptr->io_ctrl;
+
+	assert(io_ptr->sig_arr != NULL);
+	assert(io_ptr->st_arr != NULL);
+	for(uint8_t i = 0; i < io_ptr->num_sig; ++i) {
+		assert(io_ptr->sig_arr[i].get_func_ptr != NULL);
+		assert(io_ptr->sig_arr[i].size <= UDS_EXT_IO_CTRL_MAX_SIZE);
+		assert((UDS_EXT_IO_CTRL_REQ_HDR_SIZE + io_ptr->sig_arr[i].size) <= handle_ptr->cfg_ptr->tx_buf_size);
+	}
+
+	(void)memset(io_ptr->st_arr, 0, io_ptr->num_sig * sizeof(uds_ext_io_ctrl_st_s));
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_IO_CTRL_BY_ID, uds_ext_x_io_ctrl);
+}
+
+void uds_ext_x_io_handler(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_io_ctrl_s *io_ptr = &handle_ptr->cfg_ptr->io_ctrl;
+	uint32_t now_ms = uds_ext_x_io_get_ms(handle_ptr);
+
+	for(uint8_t i = 0; i < io_ptr->num_sig; ++i) {
+		if(
+			io_ptr->st_arr[i].is_active &&
+			(io_ptr->sig_arr[i].timeout_ms != 0) &&
+			((now_ms - io_ptr->st_arr[i].since_ms) >= io_ptr->sig_arr[i].timeout_ms)
+		) {
+			io_ptr->st_arr[i].is_active = false;
+		}
+	}
+}
+
+void uds_ext_x_io_abort(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_io_ctrl_s *io_ptr = &handle_ptr->cfg_ptr->io_ctrl;
+
+	for(uint8_t i = 0; i < io_ptr->num_sig; ++i) {
+		io_ptr->st_arr[i].is_active = false;
+	}
+}
+
+const uint8_t *uds_ext_x_get_io_ctrl(const uds_ext_handle_s *handle_ptr, uint8_t sig_idx)
+{
+	const uds_ext_io_ctrl_s *io_ptr;
+
+	assert(handle_ptr != NULL);
+
+	if(!handle_ptr->cfg_ptr->is_serv_en.io_ctrl) {
+		return NULL;
+	}
+	io_ptr = &handle_ptr->cfg_ptr->io_ctrl;
+	assert(sig_idx < io_ptr->num_sig);
+
+	return io_ptr->st_arr[sig_idx].is_active ? io_ptr->st_arr[sig_idx].val_arr : NULL;
+}
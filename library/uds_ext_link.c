@@ -0,0 +1,146 @@
+#include "uds_ext.h"
+#include "uds_ext_internal.h"
+#include <assert.h>
+#include <stddef.h>
+
+//! First fixed baudrate identifier of CAN, CAN125000
+#define UDS_EXT_LINK_FIXED_CAN_FIRST ((uint8_t)0x10)
+
+//! CAN baudrates in bit/s of the fixed baudrate identifiers 0x10 to 0x13
+static const uint32_t _fixed_can_baudrate_arr[] = {
+	125000u,
+	250000u,
+	500000u,
+	1000000u
+};
+
+static bool uds_ext_x_link_is_supp(const uds_ext_handle_s *handle_ptr, uint32_t baudrate)
+{
+	const uds_ext_link_ctrl_s *link_ptr = &handle_ptr->cfg_ptr->link_ctrl;
+
+	if(baudrate == link_ptr->default_baudrate) {
+		return true;
+	}
+	for(uint8_t i = 0; i < link_ptr->num_baudrate; ++i) {
+		if(link_ptr->baudrate_arr[i] == baudrate) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Verification only remembers the baudrate, transitionMode switches to it
+ * after its own positive response, see uds_ext_x_link_handler.
+ */
+static bool uds_ext_x_link_ctrl(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	uint8_t link_type;
+	uint16_t req_size;
+	uint32_t baudrate = 0;
+
+	if(data_size < 2) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_LINK_CTRL, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before any range check, so a locked client learns nothing about the supported baudrates
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_LINK_CTRL, &handle_ptr->cfg_ptr->link_ctrl.access)) {
+		return true;
+	}
+
+	link_type = data_ptr[1] & UDS_EXT_SUB_FUNC_MASK;
+	switch(link_type) {
+	case UDS_EXT_LINK_CTRL_VERIFY_FIXED:
+		req_size = 3; // baudrate identifier
+		break;
+	case UDS_EXT_LINK_CTRL_VERIFY_SPECIFIC:
+		req_size = 5; // 3 byte baudrate
+		break;
+	case UDS_EXT_LINK_CTRL_TRANSITION:
+		req_size = 2;
+		break;
+	default:
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_LINK_CTRL, UDS_EXT_NRC_SUB_FUNC_NOT_SUPP);
+		return true;
+	}
+	if(data_size != req_size) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_LINK_CTRL, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	if(link_type == UDS_EXT_LINK_CTRL_VERIFY_FIXED) {
+		uint8_t idx = data_ptr[2] - UDS_EXT_LINK_FIXED_CAN_FIRST;
+
+		if(idx < (sizeof(_fixed_can_baudrate_arr) / sizeof(uint32_t))) {
+			baudrate = _fixed_can_baudrate_arr[idx];
+		}
+	} else if(link_type == UDS_EXT_LINK_CTRL_VERIFY_SPECIFIC) {
+		baudrate = uds_ext_get_be(&data_ptr[2], 3);
+	}
+	if((link_type != UDS_EXT_LINK_CTRL_TRANSITION) && !uds_ext_x_link_is_supp(handle_ptr, baudrate)) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_LINK_CTRL, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	if(link_type == UDS_EXT_LINK_CTRL_TRANSITION) {
+		if(handle_ptr->link_verified_baudrate == 0) {
+			uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_LINK_CTRL, UDS_EXT_NRC_REQ_SEQ_ERR);
+			return true;
+		}
+		handle_ptr->link_pending_baudrate = handle_ptr->link_verified_baudrate;
+		handle_ptr->link_verified_baudrate = 0;
+	} else {
+		handle_ptr->link_verified_baudrate = baudrate;
+	}
+
+	if((data_ptr[1] & UDS_EXT_SUPPRESS_POS_RESP) == 0) {
+		handle_ptr->cfg_ptr->tx_ptr[0] = UDS_EXT_SID_LINK_CTRL + UDS_EXT_POS_RESP_OFFSET;
+		handle_ptr->cfg_ptr->tx_ptr[1] = link_type;
+		uds_ext_x_send_resp(handle_ptr, 2);
+	}
+	return true;
+}
+
+void uds_ext_x_link_init(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_link_ctrl_s *link_ptr = &handle_ptr->cfg_ptr->link_ctrl;
+
+	assert(link_ptr->set_baudrate_func_ptr != NULL);
+	assert(link_ptr->is_tx_idle_func_ptr != NULL);
+	assert((link_ptr->num_baudrate == 0) || (link_ptr->baudrate_arr != NULL));
+	assert(link_ptr->default_baudrate != 0);
+
+	handle_ptr->link_baudrate = link_ptr->default_baudrate;
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_LINK_CTRL, uds_ext_x_link_ctrl);
+}
+
+void uds_ext_x_link_handler(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_link_ctrl_s *link_ptr = &handle_ptr->cfg_ptr->link_ctrl;
+
+	// the response to the request which caused the switch goes out with the old baudrate
+	if((handle_ptr->link_pending_baudrate == 0) || !link_ptr->is_tx_idle_func_ptr()) {
+		return;
+	}
+	link_ptr->set_baudrate_func_ptr(handle_ptr->link_pending_baudrate);
+	handle_ptr->link_baudrate = handle_ptr->link_pending_baudrate;
+	handle_ptr->link_pending_baudrate = 0;
+}
+
+void uds_ext_x_link_abort(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_link_ctrl_s *link_ptr = &handle_ptr->cfg_ptr->link_ctrl;
+
+	// a transition not carried out yet is dropped, a done one is undone
+	handle_ptr->link_verified_baudrate = 0;
+	handle_ptr->link_pending_baudrate = 0;
+	if(handle_ptr->link_baudrate != link_ptr->default_baudrate) {
+		handle_ptr->link_pending_baudrate = link_ptr->default_baudrate;
+	}
+}
@@ -0,0 +1,229 @@
+#include "uds_ext.h"
+#include "uds_ext_internal.h"
+#include <assert.h>
+#include <string.h>
+
+//! lengthFormatIdentifier of the request upload response, 2 bytes maxNumberOfBlockLength
+#define UDS_EXT_UPLOAD_LFID ((uint8_t)0x20)
+//! Size of SID and block sequence counter in transfer data
+#define UDS_EXT_TRANSFER_DATA_HDR_SIZE 2u
+
+static bool uds_ext_x_is_in_region(
+	uds_ext_handle_s *handle_ptr,
+	uint32_t addr,
+	uint32_t size
+)
+{
+	const uds_ext_upload_s *upload_ptr = &handle_ptr->cfg_ptr->upload;
+
+	for(int8_t i = 0; i < upload_ptr->num_region; ++i) {
+		const uds_ext_mem_region_s *region_ptr = &upload_ptr->region_ptr[i];
+		// written this way to not overflow at the end of the address space
+		if(
+			(addr >= region_ptr->addr) &&
+			((addr - region_ptr->addr) < region_ptr->size) &&
+			(size <= (region_ptr->size - (addr - region_ptr->addr)))
+		) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool uds_ext_x_req_upload(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	const uds_ext_cfg_s *cfg_ptr = handle_ptr->cfg_ptr;
+	uint8_t *tx_ptr = cfg_ptr->tx_ptr;
+	uint8_t addr_len;
+	uint8_t size_len;
+	uint32_t addr;
+	uint32_t size;
+	uint16_t block_size;
+
+	if(data_size < 3) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// before any range check, so a locked client learns nothing about the regions
+	if(!uds_ext_x_check_allowed(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, &cfg_ptr->upload.access)) {
+		return true;
+	}
+
+	// addressAndLengthFormatIdentifier
+	addr_len = data_ptr[2] & 0x0F;
+	size_len = (data_ptr[2] >> 4) & 0x0F;
+
+	if(data_size != (3u + addr_len + size_len)) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	// only uncompressed and unencrypted data is supported
+	if(
+		(data_ptr[1] != 0) ||
+		(addr_len == 0) || (addr_len > sizeof(uint32_t)) ||
+		(size_len == 0) || (size_len > sizeof(uint32_t))
+	) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	addr = uds_ext_get_be(&data_ptr[3], addr_len);
+	size = uds_ext_get_be(&data_ptr[3 + addr_len], size_len);
+
+	if((size == 0) || !uds_ext_x_is_in_region(handle_ptr, addr, size)) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, UDS_EXT_NRC_REQ_OUT_OF_RANGE);
+		return true;
+	}
+
+	if(handle_ptr->is_upload_active) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, UDS_EXT_NRC_CONDITIONS_NOT_CORRECT);
+		return true;
+	}
+
+	block_size = cfg_ptr->upload.block_size;
+	if(block_size > cfg_ptr->tx_buf_size) {
+		block_size = cfg_ptr->tx_buf_size;
+	}
+
+	handle_ptr->is_upload_active = true;
+	handle_ptr->upload_addr = addr;
+	handle_ptr->upload_remaining = size;
+	handle_ptr->upload_block_size = block_size;
+	handle_ptr->upload_bsc = 0;
+	handle_ptr->upload_last_size = 0;
+
+	tx_ptr[0] = UDS_EXT_SID_REQ_UPLOAD + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = UDS_EXT_UPLOAD_LFID;
+	tx_ptr[2] = (uint8_t)(block_size >> 8);
+	tx_ptr[3] = (uint8_t)block_size;
+	uds_ext_x_send_resp(handle_ptr, 4);
+	return true;
+}
+
+static bool uds_ext_x_upload_transfer_data(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+	uint8_t *tx_ptr = handle_ptr->cfg_ptr->tx_ptr;
+	uint8_t bsc;
+	uint16_t size;
+
+	if(!handle_ptr->is_upload_active) {
+		return false; // download, served by core
+	}
+
+	if(data_size != 2) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_TRANSFER_DATA, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	bsc = data_ptr[1];
+
+	if((bsc == handle_ptr->upload_bsc) && (handle_ptr->upload_last_size != 0)) {
+		// client did not get the last block, serve it again
+		size = handle_ptr->upload_last_size;
+		handle_ptr->upload_addr -= size;
+		handle_ptr->upload_remaining += size;
+	} else if(bsc != (uint8_t)(handle_ptr->upload_bsc + 1)) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_TRANSFER_DATA, UDS_EXT_NRC_WRONG_BSC);
+		return true;
+	} else if(handle_ptr->upload_remaining == 0) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_TRANSFER_DATA, UDS_EXT_NRC_REQ_SEQ_ERR);
+		return true;
+	} else {
+		size = handle_ptr->upload_block_size - UDS_EXT_TRANSFER_DATA_HDR_SIZE;
+		if(size > handle_ptr->upload_remaining) {
+			size = (uint16_t)handle_ptr->upload_remaining;
+		}
+	}
+
+	// memory mapped, copied once into the response, ISO-TP copies it again into its own buffer
+	tx_ptr[0] = UDS_EXT_SID_TRANSFER_DATA + UDS_EXT_POS_RESP_OFFSET;
+	tx_ptr[1] = bsc;
+	(void)memcpy(
+		&tx_ptr[UDS_EXT_TRANSFER_DATA_HDR_SIZE],
+		(const void *)(uintptr_t)handle_ptr->upload_addr,
+		size
+	);
+
+	handle_ptr->upload_bsc = bsc;
+	handle_ptr->upload_last_size = size;
+	handle_ptr->upload_addr += size;
+	handle_ptr->upload_remaining -= size;
+
+	uds_ext_x_send_resp(handle_ptr, UDS_EXT_TRANSFER_DATA_HDR_SIZE + size);
+	return true;
+}
+
+static bool uds_ext_x_upload_transfer_exit(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	uds_ext_handle_s *handle_ptr = (uds_ext_handle_s *)handle_void_ptr;
+
+	(void)data_ptr;
+
+	if(!handle_ptr->is_upload_active) {
+		return false; // download, served by core
+	}
+
+	if(data_size != 1) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_TRANSFER_EXIT, UDS_EXT_NRC_INCORRECT_MSG_LEN);
+		return true;
+	}
+
+	if(handle_ptr->upload_remaining != 0) {
+		uds_ext_x_neg_resp(handle_ptr, UDS_EXT_SID_REQ_TRANSFER_EXIT, UDS_EXT_NRC_REQ_SEQ_ERR);
+		return true;
+	}
+
+	handle_ptr->is_upload_active = false;
+	handle_ptr->cfg_ptr->tx_ptr[0] = UDS_EXT_SID_REQ_TRANSFER_EXIT + UDS_EXT_POS_RESP_OFFSET;
+	uds_ext_x_send_resp(handle_ptr, 1);
+	return true;
+}
+
+static bool uds_ext_x_upload_routine_download(
+	void *handle_void_ptr,
+	uint8_t *data_ptr,
+	uint16_t data_size
+)
+{
+	(void)data_ptr;
+	(void)data_size;
+
+	// new download request cancels the upload, core serves it
+	((uds_ext_handle_s *)handle_void_ptr)->is_upload_active = false;
+	return false;
+}
+
+void uds_ext_x_upload_init(uds_ext_handle_s *handle_ptr)
+{
+	const uds_ext_cfg_s *cfg_ptr = handle_ptr->cfg_ptr;
+
+	assert(cfg_ptr->upload.region_ptr != NULL);
+	assert(cfg_ptr->upload.num_region > 0);
+	assert(cfg_ptr->upload.block_size > UDS_EXT_TRANSFER_DATA_HDR_SIZE);
+
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_ROUTINE_DOWNLOAD, uds_ext_x_upload_routine_download);
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_REQ_UPLOAD, uds_ext_x_req_upload);
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_TRANSFER_DATA, uds_ext_x_upload_transfer_data);
+	uds_ext_x_register_serv(handle_ptr, UDS_EXT_SID_REQ_TRANSFER_EXIT, uds_ext_x_upload_transfer_exit);
+}
+
+void uds_ext_x_upload_abort(uds_ext_handle_s *handle_ptr)
+{
+	handle_ptr->is_upload_active = false;
+}
@@ -0,0 +1,107 @@
+#include "uds_router.h"
+#include <assert.h>
+#include <stddef.h>
+
+void uds_router_x_init(uds_router_handle_s *handle_ptr, const uds_router_cfg_s *cfg_ptr)
+{
+	assert(handle_ptr != NULL);
+	assert(cfg_ptr != NULL);
+	assert(cfg_ptr->route_arr != NULL);
+	assert(cfg_ptr->recv_func_ptr != NULL);
+	assert(cfg_ptr->rx_ptr != NULL);
+	assert(cfg_ptr->rx_buf_size > 0);
+	assert(cfg_ptr->rx_buf_size <= UINT8_MAX); // size of a core request is 8 bits
+	assert(cfg_ptr->diag_sess_arr != NULL);
+
+	for(uint8_t i = 0; i < cfg_ptr->num_route; ++i) {
+		const uds_router_route_s *route_ptr = &cfg_ptr->route_arr[i];
+
+		assert(route_ptr->link_ptr != NULL);
+		assert(route_ptr->uds_handle_ptr != NULL);
+		assert(route_ptr->uds_handle_ptr->is_init);
+		assert(uds_x_get_cfg_ptr(route_ptr->uds_handle_ptr)->iso_tp_handle_ptr == route_ptr->link_ptr);
+		assert(
+			(route_ptr->ext_handle_ptr == NULL) ||
+			(route_ptr->ext_handle_ptr->uds_handle_ptr == route_ptr->uds_handle_ptr)
+		);
+		// binary search needs unique, ascending identifiers
+		assert((i == 0) || (cfg_ptr->route_arr[i - 1].rx_id < route_ptr->rx_id));
+		cfg_ptr->diag_sess_arr[i] = uds_x_get_diag_sess(route_ptr->uds_handle_ptr);
+	}
+
+	handle_ptr->cfg_ptr = cfg_ptr;
+	handle_ptr->is_init = true;
+}
+
+const uds_router_route_s *uds_router_x_find(const uds_router_handle_s *handle_ptr, uint32_t rx_id)
+{
+	const uds_router_route_s *route_arr;
+	int16_t low = 0;
+	int16_t high;
+
+	// frames may arrive before the servers are up
+	if(!handle_ptr->is_init) {
+		return NULL;
+	}
+	route_arr = handle_ptr->cfg_ptr->route_arr;
+	high = (int16_t)handle_ptr->cfg_ptr->num_route - 1;
+	while(low <= high) {
+		int16_t mid = (int16_t)((low + high) / 2);
+
+		if(route_arr[mid].rx_id == rx_id) {
+			return &route_arr[mid];
+		}
+		if(route_arr[mid].rx_id < rx_id) {
+			low = (int16_t)(mid + 1);
+		} else {
+			high = (int16_t)(mid - 1);
+		}
+	}
+	return NULL;
+}
+
+//! Aborts the extension of a server whose session has changed since the last call
+static void uds_router_x_check_sess(const uds_router_cfg_s *cfg_ptr, uint8_t route_idx)
+{
+	const uds_router_route_s *route_ptr = &cfg_ptr->route_arr[route_idx];
+	uint8_t diag_sess = uds_x_get_diag_sess(route_ptr->uds_handle_ptr);
+
+	if(diag_sess == cfg_ptr->diag_sess_arr[route_idx]) {
+		return;
+	}
+	cfg_ptr->diag_sess_arr[route_idx] = diag_sess;
+	if(route_ptr->ext_handle_ptr != NULL) {
+		uds_ext_x_abort(route_ptr->ext_handle_ptr, diag_sess);
+	}
+}
+
+void uds_router_x_process(uds_router_handle_s *handle_ptr)
+{
+	const uds_router_cfg_s *cfg_ptr;
+	uint16_t rx_size;
+
+	assert(handle_ptr != NULL);
+	assert(handle_ptr->is_init);
+
+	cfg_ptr = handle_ptr->cfg_ptr;
+	for(uint8_t i = 0; i < cfg_ptr->num_route; ++i) {
+		const uds_router_route_s *route_ptr = &cfg_ptr->route_arr[i];
+
+		rx_size = 0;
+		if(
+			cfg_ptr->recv_func_ptr(route_ptr->link_ptr, cfg_ptr->rx_ptr, cfg_ptr->rx_buf_size, &rx_size) &&
+			(
+				(route_ptr->ext_handle_ptr == NULL) ||
+				!uds_ext_x_put_packet_in(route_ptr->ext_handle_ptr, cfg_ptr->rx_ptr, rx_size)
+			)
+		) {
+			uds_x_put_packet_in(route_ptr->uds_handle_ptr, cfg_ptr->rx_ptr, (uint8_t)rx_size);
+		}
+		uds_x_handler(route_ptr->uds_handle_ptr);
+		// a request or the S3 timeout may have changed the session
+		uds_router_x_check_sess(cfg_ptr, i);
+		if(route_ptr->ext_handle_ptr != NULL) {
+			uds_ext_x_handler(route_ptr->ext_handle_ptr);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * @file uds_router.h
+ * @brief Router for several independent UDS servers on one ISO-TP/CAN stack.
+ * Every server (a logical ECU) is a route: the identifier its requests arrive on,
+ * its ISO-TP link, its core UDS handle and optionally its extension handle.
+ * The CAN receive interrupt looks up the route of a frame by identifier with a binary search
+ * and passes the frame to its link. uds_router_x_process polls all links from one loop,
+ * hands each complete request to its own server and runs the handlers of all servers.
+ *
+ * Each server has its own uds_cfg_s/uds_handle_s and uds_ext_cfg_s/uds_ext_handle_s,
+ * driven through the uds_x_* and uds_ext_x_* functions. The global wrappers stay bound
+ * to the main server. Responses go out through iso_tp_handle_ptr of the server, which has
+ * to be the link of its route.
+ *
+ * The callbacks of the core get no handle, so they cannot tell the servers apart. The router
+ * watches the session of every server instead and calls uds_ext_x_abort for the extension
+ * of the route whose session changed, S3 timeout included. The session callbacks of routed
+ * servers must not abort an extension themselves, and every server needs its own callbacks
+ * bound to its own application state.
+ *
+ * Unlike the other modules, there is no global router instance, it is only needed
+ * with more than one server.
+ */
+
+#ifndef UDS_ROUTER_H
+#define UDS_ROUTER_H
+
+#include "uds.h"
+#include "uds_ext.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief The function type polling an ISO-TP link and fetching a complete request.
+ *
+ * @param link_ptr ISO-TP link of the route.
+ * @param data_ptr Pointer to the buffer the request is copied to.
+ * @param buf_size Size of the buffer.
+ * @param data_size_ptr Pointer to the size of the received request.
+ * @return true if a complete request was received.
+ */
+typedef bool (*uds_router_recv_func_t)(
+	void *link_ptr,
+	uint8_t *data_ptr,
+	uint16_t buf_size,
+	uint16_t *data_size_ptr
+);
+
+/**
+ * @brief Structure representing a route to a UDS server.
+ */
+typedef struct {
+	uint32_t rx_id; //!< CAN identifier or logical address the requests of the server arrive on
+	void *link_ptr; //!< ISO-TP link of the server, iso_tp_handle_ptr of its core configuration
+	uds_handle_s *uds_handle_ptr; //!< core UDS handle of the server, mandatory
+	uds_ext_handle_s *ext_handle_ptr; //!< optional, extension handle bound to uds_handle_ptr
+} uds_router_route_s;
+
+/**
+ * @brief Configuration structure of the router.
+ */
+typedef struct {
+	const uds_router_route_s *route_arr; //!< routes, sorted by rx_id ascending, mandatory
+	uint8_t num_route; //!< number of routes
+	uds_router_recv_func_t recv_func_ptr; //!< mandatory
+	/// buffer of the request being dispatched, shared by all routes as requests are handled
+	/// one after the other.
+	uint8_t *rx_ptr;
+	uint16_t rx_buf_size; //!< size of the request buffer, at most 255 as the core takes 8-bit sizes
+	uint8_t *diag_sess_arr; //!< RAM, num_route sessions of the servers as last seen by the router, mandatory
+} uds_router_cfg_s;
+
+/**
+ * @brief Router handle structure.
+ */
+typedef struct {
+	const uds_router_cfg_s *cfg_ptr;
+	bool is_init;
+} uds_router_handle_s;
+
+/**
+ * @brief Initialize the router, the handles of the routes have to be initialized before.
+ *
+ * @param handle_ptr Pointer to the router handle.
+ * @param cfg_ptr Pointer to the router configuration.
+ */
+void uds_router_x_init(uds_router_handle_s *handle_ptr, const uds_router_cfg_s *cfg_ptr);
+
+/**
+ * @brief Find the route of a received identifier, can be called from interrupts.
+ *
+ * @param handle_ptr Pointer to the router handle.
+ * @param rx_id CAN identifier or logical address of the received frame.
+ * @return Pointer to the route, NULL if no server is behind the identifier or the router is not initialized.
+ */
+const uds_router_route_s *uds_router_x_find(const uds_router_handle_s *handle_ptr, uint32_t rx_id);
+
+/**
+ * @brief Poll all links, dispatch the received requests and run the handlers of all servers.
+ * A request is offered to the extension of its server first, then to the core.
+ * When the session of a server has changed, its extension is aborted before its handler runs.
+ *
+ * @param handle_ptr Pointer to the router handle.
+ */
+void uds_router_x_process(uds_router_handle_s *handle_ptr);
+
+#endif // UDS_ROUTER_H
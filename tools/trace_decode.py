@@ -0,0 +1,83 @@
+"""
+Decoder of the binary trace log written by library/trace.c.
+
+The input is a raw dump of the trace_handle_s, e.g. read out from the
+bootloader with RequestUpload at the address of _trace.
+
+Usage: python trace_decode.py <dump.bin>
+"""
+
+import struct
+import sys
+
+TRACE_MAGIC = 0x31435254
+HEADER_FMT = "<IHHI"
+REC_FMT = "<IHH3I"
+
+ID_NAMES = {
+	1: "DIAG_SESS",
+	2: "SECURITY_LEVEL",
+	3: "ECU_RESET",
+	4: "BLOCK_RECV",
+	5: "PAGE_ERASED",
+	6: "PROG_ERR",
+}
+
+PROG_ERR_NAMES = {
+	0: "INVALID_DATA",
+	1: "INVALID_ADDR",
+	2: "PAGE_OUT_OF_BOUNDS",
+	3: "FLASH_LOCKED",
+	4: "ERASE",
+	5: "WRITE",
+}
+
+
+def format_rec(rec_id, args):
+	name = ID_NAMES.get(rec_id)
+	if name is None:
+		name = "USER_0x%02X" % rec_id if rec_id >= 0x80 else "ID_%d" % rec_id
+
+	if rec_id == 4 and len(args) == 3:
+		return "%s addr=0x%08X size=%d bsc=%d" % (name, args[0], args[1], args[2])
+	if rec_id == 6 and len(args) >= 1:
+		text = "%s %s" % (name, PROG_ERR_NAMES.get(args[0], str(args[0])))
+		if len(args) >= 2:
+			text += " 0x%X" % args[1]
+		return text
+	return " ".join([name] + ["0x%X" % a for a in args])
+
+
+def decode(blob):
+	magic, rec_size, num_rec, num_written = struct.unpack_from(HEADER_FMT, blob, 0)
+	if magic != TRACE_MAGIC:
+		raise ValueError("bad magic 0x%08X, trace not initialized?" % magic)
+	if rec_size < struct.calcsize(REC_FMT):
+		raise ValueError("unexpected record size %d" % rec_size)
+
+	header_size = struct.calcsize(HEADER_FMT)
+	num_valid = min(num_written, num_rec)
+	first = num_written - num_valid
+
+	for seq in range(first, num_written):
+		offset = header_size + (seq % num_rec) * rec_size
+		ts, rec_id, num_arg, a0, a1, a2 = struct.unpack_from(REC_FMT, blob, offset)
+		args = [a0, a1, a2][:min(num_arg, 3)]
+		yield seq, ts, format_rec(rec_id, args)
+
+
+def main():
+	if len(sys.argv) != 2:
+		print(__doc__.strip())
+		return 1
+
+	with open(sys.argv[1], "rb") as f:
+		blob = f.read()
+
+	for seq, ts, text in decode(blob):
+		print("%6d %10d ms  %s" % (seq, ts, text))
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())